@@ -0,0 +1,359 @@
+#include "TestVideo.h"
+#include "Reader/VideoReader.h"
+#include "Tracking/Trackers.h"
+#include "Model/Project.h"
+#include "Model/TrackingRunner.h"
+
+#include <magic_enum.hpp>
+#include <json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+using namespace std;
+using namespace cv;
+using namespace chrono;
+using json = nlohmann::json;
+
+// Full session on the cpu backends, the runner gets a cpu reader instead of a pooled nvdec one:
+//   FFmpegDemuxer -> VideoReader -> TrackingRunner (FrameCache -> TrackerJT -> SnapResult -> TrackingCalculator) -> Project::Save
+// compared against stored baselines so regressions fail the run.
+
+struct PipelineMetrics
+{
+    double fps = 0;
+    double firstResultMs = 0;
+    double seekP50Ms = 0;
+    double seekP99Ms = 0;
+    double saveMs = 0;
+    double peakRssMb = 0;
+    int frames = 0;
+    int events = 0;
+
+    void Serialize(json& j)
+    {
+        j["fps"] = fps;
+        j["first_result_ms"] = firstResultMs;
+        j["seek_p50_ms"] = seekP50Ms;
+        j["seek_p99_ms"] = seekP99Ms;
+        j["save_ms"] = saveMs;
+        j["peak_rss_mb"] = peakRssMb;
+        j["frames"] = frames;
+        j["events"] = events;
+    }
+};
+
+static double Ms(steady_clock::time_point since)
+{
+    return duration<double, milli>(steady_clock::now() - since).count();
+}
+
+static double Percentile(vector<double> v, double p)
+{
+    if (v.empty())
+        return 0;
+
+    sort(v.begin(), v.end());
+    return v.at(min(v.size() - 1, (size_t)(p * v.size())));
+}
+
+static void ResetPeakRss()
+{
+#if !WIN32
+    // Linux resets VmHWM to the current resident size
+    ofstream clear("/proc/self/clear_refs");
+    clear << "5";
+#endif
+}
+
+static double PeakRssMb()
+{
+#if !WIN32
+    ifstream status("/proc/self/status");
+    string line;
+    while (getline(status, line))
+    {
+        if (line.rfind("VmHWM:", 0) == 0)
+            return atof(line.c_str() + 6) / 1024.0;
+    }
+#endif
+    return 0;
+}
+
+static bool RunSession(const string& file, TestVideoParams& params, TrackerJTType trackerType, PipelineMetrics& out, string& error)
+{
+    SyntheticSequence seq(TestVideoSequence(params));
+    TrackerJTStruct s = GetTracker(trackerType);
+
+    ResetPeakRss();
+    auto start = steady_clock::now();
+
+    string configPath;
+    {
+        Project project(file);
+        project.sets.clear();
+        configPath = project.GetConfigPath();
+
+        time_t duration = VideoReader::createCpu(file)->GetDuration();
+
+        auto set = make_shared<TrackingSet>(0, duration);
+        set->events = make_unique<EventList>();
+        project.sets.push_back(set);
+
+        Rect r = seq.Truth(0);
+        set->targets.emplace_back();
+        TrackingTarget& target = set->targets.back();
+        target.targetType = TARGET_TYPE::TYPE_MALE;
+        target.initialRect = r;
+        for (int y = 2; y < 6; y++)
+            for (int x = 2; x < 6; x++)
+                target.initialPoints.push_back(Point(r.x + r.width * x / 7, r.y + r.height * y / 7));
+        target.UpdateType();
+        target.preferredTracker = trackerType;
+
+        if (!target.SupportsTrackingType(s.trackingType))
+        {
+            error = "tracker does not fit the target";
+            return false;
+        }
+
+        {
+            TrackingRunner runner(VideoReader::createCpu(file), set, nullptr, true);
+            if (!runner.Setup())
+            {
+                error = "runner setup failed";
+                return false;
+            }
+
+            auto sessionStart = steady_clock::now();
+            runner.SetRunning(true);
+
+            RunnerState state = runner.GetState();
+            while (!state.finished)
+            {
+                runner.WaitFrame(500ms);
+                state = runner.GetState();
+
+                if (out.firstResultMs == 0 && state.framesTotal > 0)
+                    out.firstResultMs = Ms(start);
+            }
+
+            runner.SetRunning(false);
+
+            double sessionMs = Ms(sessionStart);
+            out.frames = state.framesTotal;
+            out.fps = sessionMs > 0 ? out.frames * 1000.0 / sessionMs : 0;
+        }
+
+        // Seeks on a reader of its own, the runner only ever reads forward
+        auto reader = VideoReader::createCpu(file);
+        vector<double> seeks;
+        for (int i = 0; i < 10; i++)
+        {
+            // Spread over the whole video in a fixed order that jumps back and forth
+            time_t to = duration * ((i * 7) % 10) / 10;
+            auto seekStart = steady_clock::now();
+
+            reader->Seek(to);
+            reader->NextHostFrame();
+            seeks.push_back(Ms(seekStart));
+        }
+
+        out.seekP50Ms = Percentile(seeks, 0.5);
+        out.seekP99Ms = Percentile(seeks, 0.99);
+
+        json j;
+        set->events->Serialize(j);
+        out.events = j.size();
+
+        auto saveStart = steady_clock::now();
+        project.Save();
+        out.saveMs = Ms(saveStart);
+    }
+
+    out.peakRssMb = PeakRssMb();
+    filesystem::remove(configPath);
+
+    return out.frames > 0;
+}
+
+static vector<TestVideoParams> DefaultCases(int frames)
+{
+    vector<TestVideoParams> cases;
+
+    auto add = [&](string codec, Size res, int gop, bool vfr) {
+        TestVideoParams p;
+        p.codec = codec;
+        p.resolution = res;
+        p.gop = gop;
+        p.vfr = vfr;
+        p.frames = frames;
+        p.name = codec + "-gop" + to_string(gop) + "-" + to_string(res.height) + "p" + (vfr ? "-vfr" : "");
+        cases.push_back(p);
+    };
+
+    add("mpeg4", Size(640, 360), 12, false);
+    add("mpeg4", Size(1280, 720), 120, false);
+    add("mpeg4", Size(640, 360), 30, true);
+    add("libx264", Size(1280, 720), 30, false);
+    add("libx264", Size(1920, 1080), 250, false);
+    add("libx264", Size(1280, 720), 60, true);
+    add("mjpeg", Size(1280, 720), 1, false);
+
+    return cases;
+}
+
+// Returns false when a metric is worse than its baseline by more than the tolerance
+static bool Compare(const string& name, PipelineMetrics& m, json& baseline, double tolerance)
+{
+    json current;
+    m.Serialize(current);
+
+    if (!baseline.contains(name))
+    {
+        cout << "[  NEW ] " << name << "  no baseline" << endl;
+        return true;
+    }
+
+    bool ok = true;
+    json& b = baseline[name];
+
+    // Throughput must not drop, everything else must not grow
+    for (string key : { "fps", "first_result_ms", "seek_p50_ms", "seek_p99_ms", "save_ms", "peak_rss_mb" })
+    {
+        if (!b.contains(key))
+            continue;
+
+        double was = b[key];
+        double now = current[key];
+        bool higherIsBetter = key == "fps";
+
+        bool regressed = higherIsBetter ? now < was * (1 - tolerance) : now > was * (1 + tolerance);
+        if (regressed)
+        {
+            cout << "[ FAIL ] " << name << "  " << key << " " << fixed << setprecision(2) << now << " vs baseline " << was << endl;
+            ok = false;
+        }
+    }
+
+    if (b.contains("events") && (int)b["events"] != m.events)
+    {
+        cout << "[ FAIL ] " << name << "  events " << m.events << " vs baseline " << (int)b["events"] << endl;
+        ok = false;
+    }
+
+    return ok;
+}
+
+int main(int argc, char* argv[])
+{
+    string baselineFile = "pipeline_baseline.json";
+    string workDir = "pipeline-bench";
+    bool writeBaseline = false;
+    double tolerance = 0.2;
+    int frames = 150;
+    string filter;
+    TrackerJTType tracker = TrackerJTType::CPU_RECT_KCF;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+            baselineFile = argv[++i];
+        else if (strcmp(argv[i], "--write-baseline") == 0)
+            writeBaseline = true;
+        else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc)
+            tolerance = atof(argv[++i]);
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            frames = max(10, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc)
+            workDir = argv[++i];
+        else if (strcmp(argv[i], "--case") == 0 && i + 1 < argc)
+            filter = argv[++i];
+        else if (strcmp(argv[i], "--tracker") == 0 && i + 1 < argc)
+        {
+            auto type = magic_enum::enum_cast<TrackerJTType>(argv[++i]);
+            if (type.has_value())
+                tracker = type.value();
+        }
+        else
+        {
+            cout << "usage: " << argv[0] << " [--baseline file] [--write-baseline] [--tolerance 0.2] [--frames n] [--dir path] [--case name] [--tracker type]" << endl;
+            return 1;
+        }
+    }
+
+    json baseline = json::object();
+    {
+        ifstream in(baselineFile);
+        if (in.good())
+            in >> baseline;
+    }
+
+    filesystem::create_directories(workDir);
+
+    json results = json::object();
+    int failed = 0;
+
+    for (auto& c : DefaultCases(frames))
+    {
+        if (!filter.empty() && c.name.find(filter) == string::npos)
+            continue;
+
+        string file = (filesystem::path(workDir) / (c.name + ".mkv")).string();
+        string error;
+
+        cout << "[ RUN  ] " << c.name << endl;
+
+        if (!EncodeTestVideo(file, c, error))
+        {
+            cout << "[ SKIP ] " << c.name << "  " << error << endl;
+            continue;
+        }
+
+        PipelineMetrics m;
+        bool ok = false;
+
+        try {
+            ok = RunSession(file, c, tracker, m, error);
+        }
+        catch (const char* e) {
+            error = e;
+        }
+
+        if (!ok)
+        {
+            cout << "[ FAIL ] " << c.name << "  " << (error.empty() ? "no frames" : error) << endl;
+            failed++;
+            continue;
+        }
+
+        m.Serialize(results[c.name]);
+
+        cout << "[      ] " << c.name << fixed << setprecision(1)
+            << "  frames " << m.frames
+            << "  fps " << m.fps
+            << "  first " << m.firstResultMs << "ms"
+            << "  seek p50 " << m.seekP50Ms << "ms p99 " << m.seekP99Ms << "ms"
+            << "  save " << m.saveMs << "ms"
+            << "  rss " << m.peakRssMb << "MB" << endl;
+
+        if (!writeBaseline && !Compare(c.name, m, baseline, tolerance))
+            failed++;
+        else
+            cout << "[  OK  ] " << c.name << endl;
+    }
+
+    if (writeBaseline)
+    {
+        ofstream o(baselineFile);
+        o << setw(4) << results << endl;
+        cout << "Baseline written to " << baselineFile << endl;
+    }
+
+    cout << (failed ? "FAILED " : "PASSED ") << failed << " regressions" << endl;
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,151 @@
+#include "SyntheticSequence.h"
+
+#include <opencv2/imgproc.hpp>
+#include <cmath>
+
+using namespace std;
+using namespace cv;
+
+static const double pi = 3.14159265358979323846;
+
+static Mat RandomTexture(RNG& rng, Size size, Size cells)
+{
+    Mat small(cells, CV_8UC3);
+    rng.fill(small, RNG::UNIFORM, Scalar::all(0), Scalar::all(256));
+
+    Mat out;
+    resize(small, out, size, 0, 0, INTER_CUBIC);
+    return out;
+}
+
+SyntheticSequence::SyntheticSequence(SequenceParams params)
+    :params(params)
+{
+    RNG rng(params.seed);
+
+    // Smooth clutter for the scene, blocky high contrast texture for the target so both points and rect trackers find features
+    Size res = params.resolution;
+    background = RandomTexture(rng, res, Size(max(2, res.width / 40), max(2, res.height / 40)));
+
+    int side = max(8, (int)(res.height * params.targetSize));
+    Mat blocks(Size(8, 8), CV_8UC3);
+    rng.fill(blocks, RNG::UNIFORM, Scalar::all(0), Scalar::all(256));
+    resize(blocks, texture, Size(side, side), 0, 0, INTER_NEAREST);
+
+    rectangle(texture, Rect(0, 0, side, side), Scalar(255, 255, 255), max(1, side / 20));
+}
+
+Point2f SyntheticSequence::TruthCenter(int i)
+{
+    double t = (double)i / max(1, params.frames);
+    double w = params.resolution.width;
+    double h = params.resolution.height;
+
+    switch (params.path)
+    {
+    case PATH_LINEAR:
+        return Point2f(w * (0.25 + 0.5 * t), h * 0.5);
+    case PATH_CIRCLE:
+        return Point2f(w * 0.5 + h * 0.25 * cos(2 * pi * t), h * 0.5 + h * 0.25 * sin(2 * pi * t));
+    case PATH_STROKE:
+    default:
+        // Three up and down strokes, the motion the application is built for
+        return Point2f(w * 0.5, h * 0.5 + h * 0.2 * sin(2 * pi * 3 * t));
+    }
+}
+
+Rect SyntheticSequence::Truth(int i)
+{
+    double t = (double)i / max(1, params.frames);
+    double scale = 1 + params.scaleChange * sin(2 * pi * t);
+
+    int side = max(4, (int)round(texture.cols * scale));
+    Point2f c = TruthCenter(i);
+
+    return Rect((int)round(c.x - side / 2.0), (int)round(c.y - side / 2.0), side, side);
+}
+
+bool SyntheticSequence::IsOccluded(int i)
+{
+    if (params.occludedFrames <= 0)
+        return false;
+
+    int start = params.frames / 2 - params.occludedFrames / 2;
+    return i >= start && i < start + params.occludedFrames;
+}
+
+Mat SyntheticSequence::Frame(int i)
+{
+    Mat frame = background.clone();
+    Rect truth = Truth(i);
+    Rect visible = truth & Rect(Point(0, 0), params.resolution);
+
+    if (!visible.empty())
+    {
+        Mat scaled;
+        resize(texture, scaled, truth.size(), 0, 0, INTER_LINEAR);
+        scaled(Rect(visible.tl() - truth.tl(), visible.size())).copyTo(frame(visible));
+    }
+
+    if (params.blur > 1 && i > 0)
+    {
+        // Smear along the direction of motion
+        Point2f v = TruthCenter(i) - TruthCenter(i - 1);
+        double angle = atan2(v.y, v.x);
+
+        Mat kernel = Mat::zeros(params.blur, params.blur, CV_32F);
+        Point2f c(params.blur / 2.0f, params.blur / 2.0f);
+        Point2f d((float)cos(angle) * params.blur / 2.0f, (float)sin(angle) * params.blur / 2.0f);
+        line(kernel, c - d, c + d, Scalar(1), 1);
+        kernel /= max(1.0, sum(kernel)[0]);
+
+        filter2D(frame, frame, -1, kernel);
+    }
+
+    if (IsOccluded(i))
+    {
+        int grow = truth.width / 10;
+        Rect cover(truth.x - grow, truth.y - grow, truth.width + grow * 2, truth.height + grow * 2);
+        rectangle(frame, cover & Rect(Point(0, 0), params.resolution), Scalar(90, 90, 90), FILLED);
+    }
+
+    Mat bgra;
+    cvtColor(frame, bgra, COLOR_BGR2BGRA);
+    return bgra;
+}
+
+vector<SequenceParams> SyntheticSequence::DefaultSuite(vector<Size> resolutions, int frames)
+{
+    vector<SequenceParams> suite;
+
+    for (auto& res : resolutions)
+    {
+        string suffix = "@" + to_string(res.height) + "p";
+
+        SequenceParams p;
+        p.resolution = res;
+        p.frames = frames;
+
+        p.name = "stroke" + suffix;
+        suite.push_back(p);
+
+        SequenceParams scaled = p;
+        scaled.name = "circle-scale" + suffix;
+        scaled.path = PATH_CIRCLE;
+        scaled.scaleChange = 0.3f;
+        suite.push_back(scaled);
+
+        SequenceParams blurred = p;
+        blurred.name = "linear-blur" + suffix;
+        blurred.path = PATH_LINEAR;
+        blurred.blur = max(3, res.height / 50);
+        suite.push_back(blurred);
+
+        SequenceParams occluded = p;
+        occluded.name = "stroke-occlusion" + suffix;
+        occluded.occludedFrames = max(2, frames / 12);
+        suite.push_back(occluded);
+    }
+
+    return suite;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+enum SequencePath
+{
+    PATH_LINEAR,
+    PATH_CIRCLE,
+    PATH_STROKE
+};
+
+struct SequenceParams
+{
+    std::string name;
+    cv::Size resolution = cv::Size(1280, 720);
+    int frames = 120;
+    SequencePath path = PATH_STROKE;
+
+    // Target side relative to the frame height
+    float targetSize = 0.2f;
+    // Relative size change over one period of the path, 0 keeps the size
+    float scaleChange = 0;
+    // Length of the motion blur kernel in pixels
+    int blur = 0;
+    // Frames in the middle of the sequence during which the target is covered
+    int occludedFrames = 0;
+
+    unsigned int seed = 1;
+};
+
+// Procedural video of one textured target moving along a known path, generated in memory.
+// Frames are BGRA like the decoder output.
+class SyntheticSequence
+{
+public:
+    SyntheticSequence(SequenceParams params);
+
+    int Size() { return params.frames; };
+    cv::Mat Frame(int i);
+    cv::Rect Truth(int i);
+    cv::Point2f TruthCenter(int i);
+    bool IsOccluded(int i);
+
+    static std::vector<SequenceParams> DefaultSuite(std::vector<cv::Size> resolutions, int frames);
+
+    SequenceParams params;
+
+protected:
+    cv::Mat background;
+    cv::Mat texture;
+};
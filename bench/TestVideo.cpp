@@ -0,0 +1,134 @@
+#include "TestVideo.h"
+
+#include <opencv2/imgproc.hpp>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/imgutils.h>
+}
+
+using namespace std;
+using namespace cv;
+
+SequenceParams TestVideoSequence(TestVideoParams& params)
+{
+    SequenceParams p;
+    p.name = params.name;
+    p.resolution = params.resolution;
+    p.frames = params.frames;
+    p.path = PATH_STROKE;
+    return p;
+}
+
+static bool WritePackets(AVFormatContext* fmt, AVCodecContext* enc, AVStream* stream, AVPacket* packet)
+{
+    while (avcodec_receive_packet(enc, packet) == 0)
+    {
+        av_packet_rescale_ts(packet, enc->time_base, stream->time_base);
+        packet->stream_index = stream->index;
+
+        if (av_interleaved_write_frame(fmt, packet) < 0)
+            return false;
+    }
+
+    return true;
+}
+
+bool EncodeTestVideo(const string& file, TestVideoParams& params, string& error)
+{
+    const AVCodec* codec = avcodec_find_encoder_by_name(params.codec.c_str());
+    if (!codec)
+    {
+        error = "encoder " + params.codec + " unavailable";
+        return false;
+    }
+
+    AVFormatContext* fmt = nullptr;
+    if (avformat_alloc_output_context2(&fmt, nullptr, "matroska", file.c_str()) < 0)
+    {
+        error = "no matroska muxer";
+        return false;
+    }
+
+    AVStream* stream = avformat_new_stream(fmt, nullptr);
+    AVCodecContext* enc = avcodec_alloc_context3(codec);
+
+    enc->width = params.resolution.width;
+    enc->height = params.resolution.height;
+    // Millisecond timestamps make variable frame durations easy
+    enc->time_base = { 1, 1000 };
+    enc->framerate = { params.fps, 1 };
+    enc->gop_size = params.gop;
+    enc->max_b_frames = 0;
+    enc->bit_rate = (int64_t)enc->width * enc->height * params.fps / 10;
+    enc->pix_fmt = codec->id == AV_CODEC_ID_MJPEG ? AV_PIX_FMT_YUVJ420P : AV_PIX_FMT_YUV420P;
+
+    if (fmt->oformat->flags & AVFMT_GLOBALHEADER)
+        enc->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+    bool ok = avcodec_open2(enc, codec, nullptr) >= 0;
+    if (!ok)
+        error = "opening " + params.codec + " failed";
+
+    if (ok)
+    {
+        avcodec_parameters_from_context(stream->codecpar, enc);
+        stream->time_base = enc->time_base;
+
+        ok = avio_open(&fmt->pb, file.c_str(), AVIO_FLAG_WRITE) >= 0 && avformat_write_header(fmt, nullptr) >= 0;
+        if (!ok)
+            error = "cannot write " + file;
+    }
+
+    if (ok)
+    {
+        SyntheticSequence seq(TestVideoSequence(params));
+        AVFrame* frame = av_frame_alloc();
+        AVPacket* packet = av_packet_alloc();
+
+        frame->format = enc->pix_fmt;
+        frame->width = enc->width;
+        frame->height = enc->height;
+        av_frame_get_buffer(frame, 0);
+
+        int64_t pts = 0;
+        int w = enc->width, h = enc->height;
+
+        for (int i = 0; i < seq.Size() && ok; i++)
+        {
+            Mat yuv;
+            cvtColor(seq.Frame(i), yuv, COLOR_BGRA2YUV_I420);
+
+            av_frame_make_writable(frame);
+
+            // I420 planes are packed one after the other in the Mat
+            const uint8_t* planes[4] = { yuv.data, yuv.data + w * h, yuv.data + w * h + (w / 2) * (h / 2), nullptr };
+            const int strides[4] = { w, w / 2, w / 2, 0 };
+            av_image_copy(frame->data, frame->linesize, planes, strides, enc->pix_fmt, w, h);
+
+            frame->pts = pts;
+            pts += (params.vfr && i % 3 == 2 ? 2000 : 1000) / params.fps;
+
+            ok = avcodec_send_frame(enc, frame) >= 0 && WritePackets(fmt, enc, stream, packet);
+        }
+
+        avcodec_send_frame(enc, nullptr);
+        ok = WritePackets(fmt, enc, stream, packet) && ok;
+
+        av_write_trailer(fmt);
+
+        av_packet_free(&packet);
+        av_frame_free(&frame);
+
+        if (!ok)
+            error = "encoding failed";
+    }
+
+    avcodec_free_context(&enc);
+    if (fmt->pb)
+        avio_closep(&fmt->pb);
+    avformat_free_context(fmt);
+
+    return ok;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "SyntheticSequence.h"
+
+#include <opencv2/core.hpp>
+#include <string>
+
+struct TestVideoParams
+{
+    std::string name;
+    // libavcodec encoder name
+    std::string codec = "mpeg4";
+    cv::Size resolution = cv::Size(640, 360);
+    int frames = 150;
+    int fps = 30;
+    int gop = 30;
+    // Every third frame is shown twice as long
+    bool vfr = false;
+};
+
+// Encodes the stroke sequence into a matroska file.
+// Returns false with a reason when the encoder is not built into libavcodec or writing fails.
+bool EncodeTestVideo(const std::string& file, TestVideoParams& params, std::string& error);
+
+SequenceParams TestVideoSequence(TestVideoParams& params);
@@ -0,0 +1,285 @@
+#include "SyntheticSequence.h"
+#include "Tracking/Trackers.h"
+#include "Model/TrackingStatus.h"
+
+#include <magic_enum.hpp>
+#include <json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#if WIN32
+#include <Windows.h>
+#include <Psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace cv;
+using namespace chrono;
+using json = nlohmann::json;
+
+struct BenchResult
+{
+    string tracker;
+    string sequence;
+    string note;
+
+    int frames = 0;
+    int failures = 0;
+    int lost = 0;
+
+    vector<double> frameMs;
+    vector<double> errors;
+    double memoryMb = 0;
+
+    double Fps()
+    {
+        double sum = 0;
+        for (auto ms : frameMs)
+            sum += ms;
+
+        return sum > 0 ? frameMs.size() * 1000.0 / sum : 0;
+    }
+
+    static double Percentile(vector<double> v, double p)
+    {
+        if (v.empty())
+            return 0;
+
+        sort(v.begin(), v.end());
+        return v.at(min(v.size() - 1, (size_t)(p * v.size())));
+    }
+
+    double MeanError()
+    {
+        if (errors.empty())
+            return 0;
+
+        double sum = 0;
+        for (auto e : errors)
+            sum += e;
+
+        return sum / errors.size();
+    }
+};
+
+static double ResidentMb()
+{
+#if WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.WorkingSetSize / (1024.0 * 1024.0);
+    return 0;
+#else
+    long pages = 0, resident = 0;
+    ifstream statm("/proc/self/statm");
+    statm >> pages >> resident;
+    return resident * (double)sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+#endif
+}
+
+static TrackingTarget MakeTarget(Rect r)
+{
+    TrackingTarget target;
+    target.targetType = TARGET_TYPE::TYPE_MALE;
+    target.initialRect = r;
+
+    // Grid of points in the inner part of the target
+    for (int y = 1; y < 5; y++)
+        for (int x = 1; x < 5; x++)
+            target.initialPoints.push_back(Point(r.x + r.width * (x + 1) / 7, r.y + r.height * (y + 1) / 7));
+
+    target.UpdateType();
+    return target;
+}
+
+static bool RunBench(TrackerJTStruct& s, SyntheticSequence& seq, BenchResult& out)
+{
+    out.tracker = s.name;
+    out.sequence = seq.params.name;
+
+    TrackingTarget target = MakeTarget(seq.Truth(0));
+    unique_ptr<TrackingStatus> state;
+    unique_ptr<TrackerJT> tracker;
+
+    double memoryStart = ResidentMb();
+    double memoryPeak = memoryStart;
+
+    try {
+        state.reset(target.InitTracking(s.trackingType));
+        tracker.reset(s.Create(target, *state));
+
+        if (!tracker)
+            return false;
+
+        HostFrame first = { { GPU_RGBA, seq.Frame(0) } };
+        tracker->init(first);
+    }
+    catch (cv::Exception& e) {
+        out.note = "unavailable";
+        return false;
+    }
+    catch (const char* e) {
+        out.note = e;
+        return false;
+    }
+
+    for (int i = 1; i < seq.Size(); i++)
+    {
+        // Generating the frame is not part of the measurement
+        HostFrame f = { { GPU_RGBA, seq.Frame(i) } };
+
+        auto start = steady_clock::now();
+        bool ok = false;
+
+        try {
+            ok = tracker->update(f);
+        }
+        catch (...) {
+            ok = false;
+        }
+
+        out.frameMs.push_back(duration<double, milli>(steady_clock::now() - start).count());
+        out.frames++;
+
+        if (!ok)
+            out.failures++;
+
+        memoryPeak = max(memoryPeak, ResidentMb());
+
+        // Nothing to find while covered, only count how well the tracker holds on afterwards
+        if (seq.IsOccluded(i))
+            continue;
+
+        Point2f truth = seq.TruthCenter(i);
+        double error = norm(Point2f(state->center) - truth);
+        out.errors.push_back(error);
+
+        if (!ok || error > seq.Truth(i).width / 2.0)
+            out.lost++;
+    }
+
+    out.memoryMb = memoryPeak - memoryStart;
+    return true;
+}
+
+static void PrintHeader()
+{
+    cout << left << setw(20) << "tracker" << setw(26) << "sequence" << right
+        << setw(8) << "fps" << setw(10) << "p50 ms" << setw(10) << "p99 ms"
+        << setw(10) << "mem MB" << setw(10) << "err px" << setw(8) << "lost" << endl;
+}
+
+static void PrintResult(BenchResult& r)
+{
+    cout << left << setw(20) << r.tracker << setw(26) << r.sequence << right << fixed << setprecision(1)
+        << setw(8) << r.Fps()
+        << setw(10) << setprecision(2) << BenchResult::Percentile(r.frameMs, 0.5)
+        << setw(10) << BenchResult::Percentile(r.frameMs, 0.99)
+        << setw(10) << setprecision(1) << r.memoryMb
+        << setw(10) << r.MeanError()
+        << setw(8) << r.lost << endl;
+}
+
+static void Serialize(BenchResult& r, json& j)
+{
+    j["tracker"] = r.tracker;
+    j["sequence"] = r.sequence;
+    j["frames"] = r.frames;
+    j["failures"] = r.failures;
+    j["lost"] = r.lost;
+    j["fps"] = r.Fps();
+    j["p50_ms"] = BenchResult::Percentile(r.frameMs, 0.5);
+    j["p99_ms"] = BenchResult::Percentile(r.frameMs, 0.99);
+    j["memory_mb"] = r.memoryMb;
+    j["center_error_px"] = r.MeanError();
+    j["center_error_p90_px"] = BenchResult::Percentile(r.errors, 0.9);
+}
+
+int main(int argc, char* argv[])
+{
+    int frames = 120;
+    vector<Size> resolutions;
+    vector<TrackerJTType> types;
+    string sequenceFilter;
+    string jsonFile;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            frames = max(2, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--resolution") == 0 && i + 1 < argc)
+        {
+            int w, h;
+            if (sscanf(argv[++i], "%dx%d", &w, &h) == 2)
+                resolutions.push_back(Size(w, h));
+        }
+        else if (strcmp(argv[i], "--tracker") == 0 && i + 1 < argc)
+        {
+            auto type = magic_enum::enum_cast<TrackerJTType>(argv[++i]);
+            if (type.has_value())
+                types.push_back(type.value());
+            else
+                cout << "Unknown tracker " << argv[i] << endl;
+        }
+        else if (strcmp(argv[i], "--sequence") == 0 && i + 1 < argc)
+            sequenceFilter = argv[++i];
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+            jsonFile = argv[++i];
+        else
+        {
+            cout << "usage: " << argv[0] << " [--frames n] [--resolution WxH]... [--tracker type]... [--sequence name] [--json file]" << endl;
+            return 1;
+        }
+    }
+
+    if (resolutions.empty())
+        resolutions = { Size(640, 360), Size(1280, 720), Size(1920, 1080) };
+
+    if (types.empty())
+    {
+        for (auto t : magic_enum::enum_values<TrackerJTType>())
+            types.push_back(t);
+    }
+
+    json report = json::array();
+    PrintHeader();
+
+    for (auto& params : SyntheticSequence::DefaultSuite(resolutions, frames))
+    {
+        if (!sequenceFilter.empty() && params.name.find(sequenceFilter) == string::npos)
+            continue;
+
+        SyntheticSequence seq(params);
+
+        for (auto type : types)
+        {
+            TrackerJTStruct s = GetTracker(type);
+            if (s.type == TrackerJTType::TRACKER_TYPE_UNKNOWN)
+                continue;
+
+            BenchResult r;
+            if (!RunBench(s, seq, r))
+            {
+                cout << left << setw(20) << r.tracker << setw(26) << r.sequence << "skipped: " << r.note << endl;
+                continue;
+            }
+
+            PrintResult(r);
+            Serialize(r, report[report.size()]);
+        }
+    }
+
+    if (!jsonFile.empty())
+    {
+        ofstream o(jsonFile);
+        o << setw(4) << report << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,307 @@
+#include "BatchTracker.h"
+#include "Model/TrackingRunner.h"
+#include "Model/Bidirectional.h"
+#include "TrackerProbe.h"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+
+using namespace std;
+using namespace chrono;
+
+BatchTracker::BatchTracker(string video, SchedulerOptions options)
+	:project(video), options(options)
+{
+
+}
+
+time_t BatchTracker::GetSetEnd(size_t index, time_t duration)
+{
+	// A set runs until the next one starts
+	if (index + 1 < project.sets.size())
+		return project.sets.at(index + 1)->timeStart;
+
+	return duration;
+}
+
+bool BatchTracker::Run()
+{
+	if (project.sets.size() == 0)
+	{
+		cout << "No tracking sets in " << project.GetConfigPath() << endl;
+		return false;
+	}
+
+	time_t duration;
+	size_t memoryPerRunner, reverseMemory;
+	{
+		auto reader = VideoReader::create(project.video);
+		duration = reader->GetDuration();
+		memoryPerRunner = TrackingRunner::EstimateMemory(reader->GetSize(), options.memoryBudget / options.maxDecoders);
+		reverseMemory = TrackingRunner::EstimateReverseMemory(reader->GetSize());
+	}
+
+	ProbeTrackers();
+
+	results.clear();
+	results.resize(project.sets.size());
+	framesTracked = 0;
+	setsFinished = 0;
+
+	auto start = steady_clock::now();
+
+	// Sets cover disjoint ranges and share no tracker state, each one gets its own runner and reader
+	auto task = [this, duration](size_t i) {
+		TrackSet(project.sets.at(i), GetSetEnd(i, duration), results.at(i));
+		setsFinished++;
+	};
+
+	// A bidirectional set runs a forward and a reverse runner, each with its own decoder
+	auto cost = [this, memoryPerRunner, reverseMemory](size_t i) {
+		SetCost c;
+		c.memory = memoryPerRunner;
+
+		if (project.sets.at(i)->IsBidirectional())
+		{
+			c.decoders = 2;
+			c.memory = memoryPerRunner * 2 + reverseMemory;
+		}
+
+		return c;
+	};
+
+	// A set that threw has no result, its entry stays not ok
+	bool ok;
+	if (sharedScheduler)
+	{
+		// The options only bound this project, the shared scheduler bounds all of them together
+		ok = sharedScheduler->Run(project.sets.size(), cost, task, priority, options.maxDecoders);
+	}
+	else
+	{
+		ProjectScheduler scheduler(options);
+		ok = scheduler.Run(project.sets.size(), cost, task);
+	}
+
+	for (auto& r : results)
+		if (!r.ok)
+			ok = false;
+
+	totalSeconds = duration_cast<chrono::milliseconds>(steady_clock::now() - start).count() / 1000.0;
+
+	project.Save();
+	project.SaveFunscript();
+
+	PrintSummary();
+	return ok;
+}
+
+void BatchTracker::ProbeTrackers()
+{
+	TrackerProbe probe(project.video);
+
+	for (auto& set : project.sets)
+	{
+		for (auto& t : set->targets)
+		{
+			if (t.preferredTracker != TrackerJTType::TRACKER_TYPE_UNKNOWN)
+				continue;
+
+			bool ok = probe.Run(set, t);
+
+			cout << "Set " << set->timeStart << ": " << TargetTypeToString(t.targetType)
+				<< (ok ? " picked " + GetTracker(t.preferredTracker).name : " no tracker held on") << endl;
+			probe.PrintScores(t);
+		}
+	}
+}
+
+bool BatchTracker::TrackSet(TrackingSetPtr set, time_t timeLimit, BatchSetResult& out)
+{
+	if (set->IsBidirectional())
+		return TrackSetBidirectional(set, timeLimit, out);
+
+	out.timeStart = set->timeStart;
+
+	TrackingRunner runner(project.video, set, nullptr, true);
+	runner.SetTimeLimit(timeLimit);
+	runner.SetMemoryBudget(options.memoryBudget / options.maxDecoders);
+	runner.SetStride(stride);
+	runner.SetLiveOutput(live);
+	if (gateThreshold >= 0)
+		runner.SetMotionGate(gateThreshold);
+
+	auto start = steady_clock::now();
+
+	if (!runner.Setup())
+	{
+		lock_guard<mutex> lock(printMtx);
+		cout << "Set " << set->timeStart << ": no usable targets, skipped" << endl;
+		return false;
+	}
+
+	out.trackers = runner.bindings.size();
+	runner.SetRunning(true);
+
+	RunnerState state = runner.GetState();
+	int reported = 0;
+	while (!state.finished)
+	{
+		runner.WaitFrame(500ms);
+		state = runner.GetState();
+
+		framesTracked += state.framesTotal - reported;
+		reported = state.framesTotal;
+	}
+
+	runner.SetRunning(false);
+
+	out.seconds = duration_cast<chrono::milliseconds>(steady_clock::now() - start).count() / 1000.0;
+	out.frames = state.framesTotal;
+	out.timeEnd = set->timeEnd;
+	out.ok = true;
+
+	lock_guard<mutex> lock(printMtx);
+	cout << "Set " << out.timeStart << "-" << out.timeEnd << ": " << out.frames << " frames in " << out.seconds << "s" << endl;
+	return true;
+}
+
+bool BatchTracker::TrackSetBidirectional(TrackingSetPtr set, time_t timeLimit, BatchSetResult& out)
+{
+	out.timeStart = set->timeStart;
+
+	TrackingSetPtr forwardSet = MakePassSet(set, false);
+	TrackingSetPtr backwardSet = MakePassSet(set, true);
+
+	// The set holds two scheduler slots, one per runner. The backward pass starts on the anchor frame, the forward
+	// pass covers it and goes on alone to where the next set starts, MergePasses keeps it wherever it is alone
+	TrackingRunner forward(project.video, forwardSet, nullptr, true);
+	forward.SetTimeLimit(timeLimit);
+	forward.SetMemoryBudget(options.memoryBudget / options.maxDecoders);
+	forward.SetStride(stride);
+	if (gateThreshold >= 0)
+		forward.SetMotionGate(gateThreshold);
+
+	TrackingRunner backward(project.video, backwardSet, nullptr, true, false, true);
+	backward.SetTimeLimit(set->timeStart);
+	backward.SetMemoryBudget(options.memoryBudget / options.maxDecoders);
+	backward.SetStride(stride);
+	if (gateThreshold >= 0)
+		backward.SetMotionGate(gateThreshold);
+
+	auto start = steady_clock::now();
+
+	if (!forward.Setup() || !backward.Setup())
+	{
+		lock_guard<mutex> lock(printMtx);
+		cout << "Set " << set->timeStart << ": no usable targets, skipped" << endl;
+		return false;
+	}
+
+	out.trackers = forward.bindings.size() + backward.bindings.size();
+
+	// Each runner has its own decoder and stage threads, the trackers of both share the worker pool
+	forward.SetRunning(true);
+	backward.SetRunning(true);
+
+	int reported = 0;
+	while (!forward.GetState().finished || !backward.GetState().finished)
+	{
+		if (!forward.GetState().finished)
+			forward.WaitFrame(500ms);
+		else
+			backward.WaitFrame(500ms);
+
+		int total = forward.GetState().framesTotal + backward.GetState().framesTotal;
+		framesTracked += total - reported;
+		reported = total;
+	}
+
+	forward.SetRunning(false);
+	backward.SetRunning(false);
+
+	int merged = MergePasses(set, *forwardSet->events, *backwardSet->events);
+
+	out.seconds = duration_cast<chrono::milliseconds>(steady_clock::now() - start).count() / 1000.0;
+	out.frames = forward.GetState().framesTotal + backward.GetState().framesTotal;
+	out.timeEnd = set->timeEnd;
+	out.ok = true;
+
+	lock_guard<mutex> lock(printMtx);
+	cout << "Set " << out.timeStart << "-" << out.timeEnd << ": " << out.frames << " frames in " << out.seconds << "s, " << merged << " merged" << endl;
+	return true;
+}
+
+bool BatchTracker::RecordSet(size_t index, string file)
+{
+	if (index >= project.sets.size())
+	{
+		cout << "No set " << index << " in " << project.GetConfigPath() << endl;
+		return false;
+	}
+
+	TrackingSetPtr set = project.sets.at(index);
+
+	auto recorder = make_shared<FrameRecorder>(file, set);
+	if (!recorder->IsOpen())
+	{
+		cout << "Cannot write " << file << endl;
+		return false;
+	}
+
+	time_t duration;
+	{
+		auto reader = VideoReader::create(project.video);
+		duration = reader->GetDuration();
+	}
+
+	// Every tracker type runs so the recording holds all the variants a replay can ask for
+	TrackingRunner runner(project.video, set, nullptr, false, true);
+	runner.SetTimeLimit(GetSetEnd(index, duration));
+	runner.SetMemoryBudget(options.memoryBudget);
+	runner.SetRecorder(recorder);
+
+	if (!runner.Setup())
+	{
+		cout << "Set " << set->timeStart << ": no usable targets" << endl;
+		return false;
+	}
+
+	runner.SetRunning(true);
+
+	while (!runner.GetState().finished)
+		runner.WaitFrame(500ms);
+
+	runner.SetRunning(false);
+
+	cout << "Recorded " << recorder->GetFrames() << " frames of set " << set->timeStart << " to " << file << endl;
+	return true;
+}
+
+void BatchTracker::PrintSummary()
+{
+	int frames = 0;
+	for (auto& r : results)
+		frames += r.frames;
+
+	cout << endl << "Tracked " << results.size() << " sets (" << options.maxDecoders << " at a time), " << frames << " frames in " << totalSeconds << "s";
+	if (totalSeconds > 0)
+		cout << " (" << fixed << setprecision(1) << frames / totalSeconds << " fps)";
+	cout << endl;
+
+	for (auto& r : results)
+	{
+		cout << "  " << setw(10) << r.timeStart << " - " << setw(10) << r.timeEnd
+			<< "  trackers " << r.trackers
+			<< "  frames " << setw(6) << r.frames;
+
+		if (r.seconds > 0)
+			cout << "  " << fixed << setprecision(1) << r.frames / r.seconds << " fps";
+
+		if (!r.ok)
+			cout << "  skipped";
+
+		cout << endl;
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Model/Project.h"
+#include "ProjectScheduler.h"
+#include "Net/PositionStream.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct BatchSetResult
+{
+	time_t timeStart = 0;
+	time_t timeEnd = 0;
+	int frames = 0;
+	int trackers = 0;
+	double seconds = 0;
+	bool ok = false;
+};
+
+// Tracks every set of a project without a window and writes the results
+class BatchTracker
+{
+public:
+	BatchTracker(std::string video, SchedulerOptions options = SchedulerOptions());
+
+	bool Run();
+	bool TrackSet(TrackingSetPtr set, time_t timeLimit, BatchSetResult& out);
+	// Tracks forward from the start and backward from the end anchors at the same time and merges both,
+	// the forward pass then goes on past the anchors up to the time limit
+	bool TrackSetBidirectional(TrackingSetPtr set, time_t timeLimit, BatchSetResult& out);
+	// Writes the frames of one set for TrackerReplay
+	bool RecordSet(size_t index, std::string file);
+	void PrintSummary();
+	// Picks a tracker with TrackerProbe for every target that has none, the runner skips those otherwise
+	void ProbeTrackers();
+	// Track every nth frame, see TrackingRunner::SetStride
+	void SetStride(int s) { stride = s; };
+	// See TrackingRunner::SetMotionGate, negative leaves it off
+	void SetMotionGate(double threshold) { gateThreshold = threshold; };
+	// Shares decoders and frame memory with other trackers instead of using the options alone, see JobServer
+	void SetScheduler(ProjectScheduler* s, int p) { sharedScheduler = s; priority = p; };
+	// See TrackingRunner::SetLiveOutput, bidirectional sets only have positions once both directions are merged and are not sent
+	void SetLiveOutput(PositionStreamPtr s) { live = s; };
+
+	// Progress while Run is going
+	int64_t GetFramesTracked() { return framesTracked; };
+	int GetSetsFinished() { return setsFinished; };
+
+	Project project;
+
+protected:
+	time_t GetSetEnd(size_t index, time_t duration);
+
+	SchedulerOptions options;
+	int stride = 1;
+	double gateThreshold = -1;
+	ProjectScheduler* sharedScheduler = nullptr;
+	int priority = 0;
+	PositionStreamPtr live;
+	std::atomic<int64_t> framesTracked = 0;
+	std::atomic<int> setsFinished = 0;
+	std::mutex printMtx;
+	std::vector<BatchSetResult> results;
+	double totalSeconds = 0;
+};
@@ -0,0 +1,358 @@
+#include "JobServer.h"
+#include "Diagnostics/Trace.h"
+#include "Reader/VideoReader.h"
+#include "Tracking/Trackers.h"
+
+#include <magic_enum.hpp>
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+using namespace chrono;
+
+JobServer::JobServer(ServerOptions options)
+	:options(options), scheduler(options.scheduler)
+{
+	// One warm decoder and tracker per decoder the server runs at once
+	READER_POOL->SetCapacity(options.scheduler.maxDecoders);
+	TRACKER_POOL->SetCapacity(options.scheduler.maxDecoders);
+}
+
+JobServer::~JobServer()
+{
+	{
+		lock_guard<mutex> lock(mtx);
+		stopping = true;
+	}
+
+	ReapConnections(true);
+
+	for (auto& j : jobs)
+		if (j->thread.joinable())
+			j->thread.join();
+
+	READER_POOL->SetCapacity(0);
+	TRACKER_POOL->SetCapacity(0);
+}
+
+bool JobServer::IsStopping()
+{
+	lock_guard<mutex> lock(mtx);
+	return stopping;
+}
+
+void JobServer::ReapConnections(bool all)
+{
+	for (auto it = connections.begin(); it != connections.end();)
+	{
+		if (!all && !*it->done)
+		{
+			it++;
+			continue;
+		}
+
+		it->thread.join();
+		it = connections.erase(it);
+	}
+}
+
+void JobServer::ReapJobs()
+{
+	vector<thread> finished;
+
+	{
+		lock_guard<mutex> lock(mtx);
+
+		int kept = 0;
+		for (int i = jobs.size() - 1; i >= 0; i--)
+		{
+			Job& job = *jobs[i];
+			if (job.state == JobState::QUEUED || job.state == JobState::RUNNING)
+				continue;
+
+			// The thread is past the state change and only has to exit
+			if (job.thread.joinable())
+				finished.push_back(move(job.thread));
+
+			if (++kept > options.keepFinished)
+				jobs.erase(jobs.begin() + i);
+		}
+	}
+
+	// Outside the lock, a job thread still needs it to return from RunJob
+	for (auto& t : finished)
+		t.join();
+}
+
+json JobServer::Submit(json& message)
+{
+	auto job = make_unique<Job>();
+	job->video = message.value("video", "");
+	job->priority = message.value("priority", 0);
+	job->stride = max(1, message.value("stride", 1));
+	job->gate = message.value("gate", -1.0);
+
+	// A job never gets more than the whole server
+	job->quota.maxDecoders = clamp(message.value("decoders", options.scheduler.maxDecoders), 1, options.scheduler.maxDecoders);
+	size_t memory = message.contains("memory") ? (size_t)max(1, message.value("memory", 1)) * 1024 * 1024 : options.scheduler.memoryBudget;
+	job->quota.memoryBudget = min(options.scheduler.memoryBudget, memory);
+
+	if (message.contains("project") && message["project"].is_object())
+		job->project = message["project"];
+
+	if (job->video.empty())
+		return { { "type", "error" }, { "error", "No video" } };
+
+	job->submitted = steady_clock::now();
+
+	lock_guard<mutex> lock(mtx);
+
+	if (stopping)
+		return { { "type", "error" }, { "error", "Shutting down" } };
+
+	job->id = nextId++;
+	int id = job->id;
+
+	cout << "Job " << id << " queued: " << job->video << " priority " << job->priority << endl;
+
+	jobs.push_back(move(job));
+	Dispatch();
+
+	return { { "type", "accepted" }, { "job", id } };
+}
+
+json JobServer::Status()
+{
+	json reply = { { "type", "status" }, { "jobs", json::array() } };
+
+	lock_guard<mutex> lock(mtx);
+	auto now = steady_clock::now();
+
+	for (auto& job : jobs)
+	{
+		json& j = reply["jobs"][reply["jobs"].size()];
+		j["id"] = job->id;
+		j["video"] = job->video;
+		j["state"] = magic_enum::enum_name(job->state);
+		j["priority"] = job->priority;
+
+		if (!job->error.empty())
+			j["error"] = job->error;
+
+		int64_t frames = job->tracker ? job->tracker->GetFramesTracked() : job->frames;
+		double seconds = 0;
+
+		if (job->state == JobState::RUNNING)
+			seconds = duration_cast<milliseconds>(now - job->started).count() / 1000.0;
+		else if (job->state == JobState::DONE || job->state == JobState::FAILED)
+			seconds = duration_cast<milliseconds>(job->finished - job->started).count() / 1000.0;
+
+		j["sets"] = job->sets;
+		j["sets_done"] = job->tracker ? job->tracker->GetSetsFinished() : job->setsDone;
+		j["frames"] = frames;
+		j["seconds"] = seconds;
+		j["fps"] = seconds > 0 ? frames / seconds : 0;
+	}
+
+	return reply;
+}
+
+json JobServer::Cancel(int id)
+{
+	lock_guard<mutex> lock(mtx);
+
+	for (auto& job : jobs)
+	{
+		if (job->id != id || job->state != JobState::QUEUED)
+			continue;
+
+		job->state = JobState::CANCELLED;
+		cout << "Job " << id << " cancelled" << endl;
+		return { { "type", "cancelled" }, { "ok", true } };
+	}
+
+	// Running jobs keep going, BatchTracker cannot stop halfway through a set
+	return { { "type", "cancelled" }, { "ok", false } };
+}
+
+void JobServer::Dispatch()
+{
+	while (!stopping && running < options.maxJobs)
+	{
+		Job* next = nullptr;
+
+		// Jobs are in submission order, the first one of the highest priority wins
+		for (auto& job : jobs)
+			if (job->state == JobState::QUEUED && (!next || job->priority > next->priority))
+				next = job.get();
+
+		if (!next)
+			return;
+
+		next->state = JobState::RUNNING;
+		next->started = steady_clock::now();
+		running++;
+
+		next->thread = thread([this, next]() { RunJob(next); });
+	}
+}
+
+void JobServer::RunJob(Job* job)
+{
+	Tracer::SetThreadName("job " + to_string(job->id));
+
+	bool ok = false;
+	string error;
+
+	try {
+		auto tracker = make_unique<BatchTracker>(job->video, job->quota);
+
+		if (!job->project.is_null())
+		{
+			tracker->project.sets.clear();
+			tracker->project.Load(job->project);
+		}
+
+		tracker->SetStride(job->stride);
+		tracker->SetMotionGate(job->gate);
+		tracker->SetScheduler(&scheduler, job->priority);
+
+		BatchTracker* t = tracker.get();
+		{
+			lock_guard<mutex> lock(mtx);
+			job->sets = tracker->project.sets.size();
+			job->tracker = move(tracker);
+		}
+
+		ok = t->Run();
+		if (!ok)
+			error = "Not every set was tracked";
+	}
+	catch (const char* e) {
+		error = e;
+	}
+	catch (...) {
+		error = "Tracking failed";
+	}
+
+	// Destroyed after the lock is released
+	unique_ptr<BatchTracker> tracker;
+	lock_guard<mutex> lock(mtx);
+
+	job->state = ok ? JobState::DONE : JobState::FAILED;
+	job->error = error;
+	job->finished = steady_clock::now();
+	running--;
+
+	// Frees the project, its results and the runners' memory, status only needs the counters
+	if (job->tracker)
+	{
+		job->setsDone = job->tracker->GetSetsFinished();
+		job->frames = job->tracker->GetFramesTracked();
+		tracker = move(job->tracker);
+	}
+
+	cout << "Job " << job->id << (ok ? " done" : " failed: " + error) << endl;
+
+	Dispatch();
+	cv.notify_all();
+}
+
+void JobServer::Serve(LineSocket socket)
+{
+	Tracer::SetThreadName("job connection");
+
+	json message;
+	while (true)
+	{
+		// Wakes up now and then so an idle client does not hold up shutdown
+		if (!socket.Receive(message, 500))
+		{
+			if (!socket.IsOpen() || IsStopping())
+				return;
+
+			continue;
+		}
+
+		string type = message.value("type", "");
+		json reply;
+
+		if (type == "submit")
+			reply = Submit(message);
+		else if (type == "status")
+			reply = Status();
+		else if (type == "cancel")
+			reply = Cancel(message.value("job", 0));
+		else if (type == "shutdown")
+		{
+			lock_guard<mutex> lock(mtx);
+			stopping = true;
+			reply = { { "type", "bye" } };
+		}
+		else
+			reply = { { "type", "error" }, { "error", "Unknown request " + type } };
+
+		if (!socket.Send(reply))
+			return;
+	}
+}
+
+bool JobServer::Run()
+{
+	// Requests name files on this machine, nobody else gets to send them
+	LineSocket server;
+	if (!server.Listen(options.port, true))
+	{
+		cout << "Cannot listen on port " << options.port << endl;
+		return false;
+	}
+
+	cout << "Serving tracking jobs on port " << server.GetPort() << endl;
+
+	while (!IsStopping())
+	{
+		ReapConnections(false);
+		ReapJobs();
+
+		LineSocket socket;
+		if (!server.Accept(socket, 500))
+			continue;
+
+		Connection c;
+		c.done = make_shared<atomic<bool>>(false);
+		c.thread = thread([this, done = c.done, s = move(socket)]() mutable {
+			Serve(move(s));
+			*done = true;
+		});
+
+		connections.push_back(move(c));
+	}
+
+	server.Close();
+
+	// Every connection sees stopping within its receive timeout and closes its socket
+	ReapConnections(true);
+
+	unique_lock<mutex> lock(mtx);
+
+	for (auto& job : jobs)
+		if (job->state == JobState::QUEUED)
+			job->state = JobState::CANCELLED;
+
+	cout << "Shutting down, waiting for " << running << " running jobs" << endl;
+	cv.wait(lock, [this]() { return running == 0; });
+	lock.unlock();
+
+	ReapJobs();
+
+	return true;
+}
+
+bool JobServer::Request(int port, const json& request, json& reply)
+{
+	LineSocket socket;
+	if (!socket.Connect("127.0.0.1", port))
+		return false;
+
+	return socket.Send(request) && socket.Receive(reply);
+}
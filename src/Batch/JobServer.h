@@ -0,0 +1,119 @@
+#pragma once
+
+#include "BatchTracker.h"
+#include "ProjectScheduler.h"
+#include "Net/LineSocket.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ServerOptions
+{
+	// 0 picks a free port
+	int port = 0;
+	// Projects tracked at the same time, the rest wait in the queue
+	int maxJobs = 2;
+	// Finished jobs status still reports, the oldest ones beyond this are forgotten
+	int keepFinished = 100;
+	// Decoders and frame memory shared by all running projects
+	SchedulerOptions scheduler;
+};
+
+enum class JobState
+{
+	QUEUED,
+	RUNNING,
+	DONE,
+	FAILED,
+	CANCELLED
+};
+
+struct Job
+{
+	int id = 0;
+	std::string video;
+	// Replaces the saved project of the video when set
+	json project;
+	int priority = 0;
+	// Decoders and memory this job may use at most, within the shared limits
+	SchedulerOptions quota;
+	int stride = 1;
+	double gate = -1;
+
+	JobState state = JobState::QUEUED;
+	std::string error;
+	std::chrono::steady_clock::time_point submitted;
+	std::chrono::steady_clock::time_point started;
+	std::chrono::steady_clock::time_point finished;
+
+	// Only held while the job runs, the counters below are copied out of it when it finishes
+	std::unique_ptr<BatchTracker> tracker;
+	int sets = 0;
+	int setsDone = 0;
+	int64_t frames = 0;
+	std::thread thread;
+};
+
+// Stays resident and tracks the projects clients submit, so the CUDA context, the worker pool and the frame
+// cache are set up once instead of once per video. Decoders and trackers with network weights of finished
+// sets are kept in READER_POOL and TRACKER_POOL for the next sets and jobs. All running jobs share one
+// ProjectScheduler: higher priority jobs get the next free decoder first and every job is held to its own quota.
+//
+// Clients talk one json message per line over LineSocket, each request gets one reply:
+//   {"type":"submit","video":...,"project":{...}?,"priority":n?,"decoders":n?,"memory":mb?,"stride":n?,"gate":x?}
+//       -> {"type":"accepted","job":id}
+//   {"type":"status"} -> {"type":"status","jobs":[{"id","video","state","priority","sets","sets_done","frames","fps","seconds"}]}
+//   {"type":"cancel","job":id} -> {"type":"cancelled","ok":bool}, only queued jobs can be cancelled
+//   {"type":"shutdown"} -> {"type":"bye"}, running jobs are finished first and queued ones dropped
+class JobServer
+{
+public:
+	JobServer(ServerOptions options);
+	~JobServer();
+
+	// Serves until a client asks for shutdown
+	bool Run();
+
+	// Sends one request to a server on this machine, false when there is none or it did not answer
+	static bool Request(int port, const json& request, json& reply);
+
+protected:
+	struct Connection
+	{
+		std::thread thread;
+		std::shared_ptr<std::atomic<bool>> done;
+	};
+
+	// Returns once the client is gone or the server stops
+	void Serve(LineSocket socket);
+	// Joins the connections whose client is gone, or all of them
+	void ReapConnections(bool all);
+	// Joins the threads of finished jobs and forgets the oldest finished jobs beyond keepFinished
+	void ReapJobs();
+	bool IsStopping();
+	json Submit(json& message);
+	json Status();
+	json Cancel(int id);
+	// Starts queued jobs by priority and submission while there is room, mtx has to be held
+	void Dispatch();
+	void RunJob(Job* job);
+
+	ServerOptions options;
+	ProjectScheduler scheduler;
+
+	std::mutex mtx;
+	std::condition_variable cv;
+	std::vector<std::unique_ptr<Job>> jobs;
+	int nextId = 1;
+	int running = 0;
+	bool stopping = false;
+	// Only touched by the thread in Run
+	std::list<Connection> connections;
+};
@@ -0,0 +1,101 @@
+#include "ProjectScheduler.h"
+
+#include <atomic>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+ProjectScheduler::ProjectScheduler(SchedulerOptions options)
+	:options(options)
+{
+
+}
+
+void ProjectScheduler::Acquire(SetCost cost, int priority, int& active, int maxActive)
+{
+	unique_lock<mutex> lock(mtx);
+
+	// Only sets that could start count as waiting, one held back by its own limit must not block lower priorities
+	cv.wait(lock, [&active, maxActive, cost]() { return maxActive == 0 || active == 0 || active + cost.decoders <= maxActive; });
+
+	auto it = waiting.insert(priority);
+
+	// A single set always runs, even when it alone is over budget
+	cv.wait(lock, [this, cost, priority]() {
+		if (*waiting.rbegin() > priority)
+			return false;
+
+		if (activeDecoders == 0)
+			return true;
+
+		return activeDecoders + cost.decoders <= options.maxDecoders && memoryUsed + cost.memory <= options.memoryBudget;
+	});
+
+	waiting.erase(it);
+	activeDecoders += cost.decoders;
+	memoryUsed += cost.memory;
+	active += cost.decoders;
+
+	// The next waiter of the same priority may fit as well
+	cv.notify_all();
+}
+
+void ProjectScheduler::Release(SetCost cost, int& active)
+{
+	{
+		lock_guard<mutex> lock(mtx);
+		activeDecoders -= cost.decoders;
+		memoryUsed -= cost.memory;
+		active -= cost.decoders;
+	}
+
+	cv.notify_all();
+}
+
+bool ProjectScheduler::Run(size_t numSets, CostFunc cost, SetTask task, int priority, int maxDecoders)
+{
+	vector<thread> threads;
+	// Decoders of this call in use, guarded by mtx
+	int active = 0;
+	atomic<bool> ok(true);
+
+	for (size_t i = 0; i < numSets; i++)
+	{
+		SetCost c = cost(i);
+		Acquire(c, priority, active, maxDecoders);
+
+		threads.emplace_back([this, i, c, task, &active, &ok]() {
+			// Free the slot even when the set failed
+			string error;
+
+			try {
+				task(i);
+			}
+			catch (const char* e) {
+				error = e;
+			}
+			catch (const exception& e) {
+				error = e.what();
+			}
+			catch (...) {
+				error = "Tracking failed";
+			}
+
+			if (!error.empty())
+			{
+				cout << "Set " << i << " failed: " << error << endl;
+				ok = false;
+			}
+
+			Release(c, active);
+		});
+	}
+
+	for (auto& t : threads)
+		t.join();
+
+	return ok;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Model/Project.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <vector>
+
+struct SchedulerOptions
+{
+	int maxDecoders = 4;
+	size_t memoryBudget = (size_t)4096 * 1024 * 1024;
+};
+
+// What one set holds while it runs
+struct SetCost
+{
+	int decoders = 1;
+	size_t memory = 0;
+};
+
+// Runs independent tracking sets at the same time, bounded by the number of decoders and the frame memory in flight.
+// Several Run calls can share one scheduler, see JobServer.
+class ProjectScheduler
+{
+public:
+	typedef std::function<void(size_t index)> SetTask;
+	typedef std::function<SetCost(size_t index)> CostFunc;
+
+	ProjectScheduler(SchedulerOptions options);
+
+	// Waiting sets of a higher priority start first, maxDecoders limits the decoders of this call in use at once, 0 for no limit.
+	// False when a task threw, the other sets still run
+	bool Run(size_t numSets, CostFunc cost, SetTask task, int priority = 0, int maxDecoders = 0);
+
+protected:
+	void Acquire(SetCost cost, int priority, int& active, int maxActive);
+	void Release(SetCost cost, int& active);
+
+	SchedulerOptions options;
+
+	std::mutex mtx;
+	std::condition_variable cv;
+	int activeDecoders = 0;
+	size_t memoryUsed = 0;
+	// Priorities of the sets waiting for a decoder
+	std::multiset<int> waiting;
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <ctime>
+
+// Sharded tracking, messages are one json object per line (see LineSocket)
+//   worker -> coordinator  { "type": "hello" }
+//   coordinator -> worker  { "type": "shard", "id", "video", "set", "from", "to", "stride", "gate" }
+//   worker -> coordinator  { "type": "events", "id", "events" }, any number while tracking, in time order
+//   worker -> coordinator  { "type": "progress", "id", "frames" }, about once a second while tracking
+//   worker -> coordinator  { "type": "done", "id", "ok", "frames", "time_end", "checkpoints" }
+//   coordinator -> worker  { "type": "quit" }
+// A worker gets its next shard after it reported the last one done. A worker that sends nothing for too long
+// is disconnected and its shard counts as a failed attempt.
+
+// Part of a tracking set tracked by one worker. A shard inside a set starts on a checkpoint of the set.
+struct Shard
+{
+	int id = 0;
+	size_t setIndex = 0;
+	time_t from = 0;
+	// 0 tracks to the end of the video
+	time_t to = 0;
+
+	bool InRange(time_t t)
+	{
+		return t >= from && (to == 0 || t < to);
+	}
+};
@@ -0,0 +1,386 @@
+#include "ShardCoordinator.h"
+#include "Diagnostics/Trace.h"
+
+#include <magic_enum.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+using namespace chrono;
+
+ShardCoordinator::ShardCoordinator(string video, CoordinatorOptions options)
+	:project(video), options(options)
+{
+
+}
+
+void ShardCoordinator::MakeShards()
+{
+	shards.clear();
+	setMessages.clear();
+
+	for (size_t i = 0; i < project.sets.size(); i++)
+	{
+		TrackingSetPtr set = project.sets.at(i);
+
+		setMessages.emplace_back();
+		set->Serialize(setMessages.back());
+
+		// A set runs until the next one starts
+		time_t end = i + 1 < project.sets.size() ? project.sets.at(i + 1)->timeStart : 0;
+
+		vector<time_t> splits = { set->timeStart };
+
+		// Only checkpoints taken with the current targets can start a shard
+		json setup = set->GetSetup();
+		if (options.shardLength > 0 && !set->IsBidirectional() && set->checkpoints->Matches(setup))
+		{
+			for (auto t : set->checkpoints->Times())
+			{
+				if (t - splits.back() >= options.shardLength && (end == 0 || t < end))
+					splits.push_back(t);
+			}
+		}
+
+		for (size_t s = 0; s < splits.size(); s++)
+		{
+			ShardState state;
+			state.shard.id = shards.size();
+			state.shard.setIndex = i;
+			state.shard.from = splits.at(s);
+			state.shard.to = s + 1 < splits.size() ? splits.at(s + 1) : end;
+			shards.push_back(move(state));
+		}
+	}
+}
+
+bool ShardCoordinator::AllFinished()
+{
+	lock_guard<mutex> lock(mtx);
+
+	for (auto& s : shards)
+		if (s.status == ShardStatus::PENDING || s.status == ShardStatus::RUNNING)
+			return false;
+
+	return true;
+}
+
+int ShardCoordinator::TakeShard()
+{
+	unique_lock<mutex> lock(mtx);
+
+	while (true)
+	{
+		bool running = false;
+
+		for (int i = 0; i < shards.size(); i++)
+		{
+			auto& s = shards.at(i);
+
+			if (s.status == ShardStatus::RUNNING)
+				running = true;
+
+			if (s.status != ShardStatus::PENDING)
+				continue;
+
+			s.status = ShardStatus::RUNNING;
+			s.attempts++;
+			s.events = make_unique<EventList>();
+			s.checkpoints = json::array();
+			return i;
+		}
+
+		if (!running)
+			return -1;
+
+		cv.wait(lock);
+	}
+}
+
+void ShardCoordinator::AddFragment(int index, json& events)
+{
+	lock_guard<mutex> lock(mtx);
+	auto& s = shards.at(index);
+
+	for (auto& e : events)
+	{
+		EventPtr event = make_shared<TrackingEvent>(TrackingEvent::Unserialize(e));
+		if (s.shard.InRange(event->time))
+			s.events->AddEvent(event);
+	}
+}
+
+void ShardCoordinator::FinishShard(int index, json& done)
+{
+	{
+		lock_guard<mutex> lock(mtx);
+		auto& s = shards.at(index);
+
+		if (done.value("ok", false))
+		{
+			s.status = ShardStatus::DONE;
+			s.timeEnd = done.value("time_end", (time_t)0);
+			s.frames = done.value("frames", 0);
+
+			if (done.contains("checkpoints"))
+				s.checkpoints = done["checkpoints"];
+		}
+		else
+		{
+			s.status = s.attempts < options.maxAttempts ? ShardStatus::PENDING : ShardStatus::FAILED;
+		}
+
+		cout << "Shard " << s.shard.id << " (set " << project.sets.at(s.shard.setIndex)->timeStart << " from " << s.shard.from << "): "
+			<< magic_enum::enum_name(s.status) << ", " << s.frames << " frames" << endl;
+	}
+
+	cv.notify_all();
+}
+
+void ShardCoordinator::Serve(LineSocket socket)
+{
+	Tracer::SetThreadName("shard connection");
+
+	json message;
+	if (!socket.Receive(message, options.workerTimeout) || message.value("type", "") != "hello")
+		return;
+
+	while (true)
+	{
+		int index = TakeShard();
+		if (index < 0)
+		{
+			socket.Send({ { "type", "quit" } });
+			return;
+		}
+
+		Shard shard = shards.at(index).shard;
+
+		json request = {
+			{ "type", "shard" },
+			{ "id", shard.id },
+			{ "video", project.video },
+			{ "set", setMessages.at(shard.setIndex) },
+			{ "from", shard.from },
+			{ "to", shard.to },
+			{ "stride", options.stride },
+			{ "gate", options.gate }
+		};
+
+		json done = { { "ok", false } };
+
+		if (socket.Send(request))
+		{
+			while (true)
+			{
+				// Workers report progress every second, a hung one must not keep the shard forever
+				if (!socket.Receive(message, options.progressTimeout))
+				{
+					if (socket.IsOpen())
+					{
+						cout << "Shard " << shard.id << ": nothing from its worker for " << options.progressTimeout / 1000 << "s, dropping it" << endl;
+						socket.Close();
+					}
+
+					break;
+				}
+
+				string type = message.value("type", "");
+
+				if (type == "events")
+				{
+					AddFragment(index, message["events"]);
+				}
+				else if (type == "done")
+				{
+					done = message;
+					break;
+				}
+			}
+		}
+
+		// A lost connection counts as a failed attempt, the shard goes to the next worker that asks
+		FinishShard(index, done);
+
+		if (!socket.IsOpen())
+			return;
+	}
+}
+
+void ShardCoordinator::LaunchWorker(string self, int port)
+{
+	string command = "\"" + self + "\" --worker 127.0.0.1:" + to_string(port);
+#if WIN32
+	// cmd strips the outer quotes
+	command = "\"" + command + "\"";
+#endif
+
+	// A worker that cannot even connect must not be restarted forever, nor right away
+	auto backoff = 1s;
+
+	for (int launch = 0; launch <= options.maxAttempts && !AllFinished(); launch++)
+	{
+		if (launch > 0)
+		{
+			this_thread::sleep_for(backoff);
+			backoff *= 2;
+		}
+
+		int ret = system(command.c_str());
+
+		// A worker only exits cleanly once there are no shards left to hand out
+		if (ret == 0 || AllFinished())
+			break;
+
+		cout << "Local worker exited with " << ret << (launch < options.maxAttempts ? ", starting another" : ", giving up on it") << endl;
+	}
+
+	{
+		lock_guard<mutex> lock(mtx);
+		launchers--;
+	}
+}
+
+bool ShardCoordinator::HasWorkers()
+{
+	lock_guard<mutex> lock(mtx);
+	return connections > 0 || launchers > 0;
+}
+
+void ShardCoordinator::FailPending()
+{
+	{
+		lock_guard<mutex> lock(mtx);
+
+		for (auto& s : shards)
+			if (s.status == ShardStatus::PENDING)
+				s.status = ShardStatus::FAILED;
+	}
+
+	cv.notify_all();
+}
+
+bool ShardCoordinator::Merge()
+{
+	bool ok = true;
+
+	// Shards are in set and time order, later shards of a set only touch their own range
+	for (auto& s : shards)
+	{
+		TrackingSetPtr set = project.sets.at(s.shard.setIndex);
+
+		if (s.status != ShardStatus::DONE)
+		{
+			cout << "Shard " << s.shard.id << " failed, set " << set->timeStart << " keeps its old results from " << s.shard.from << endl;
+			ok = false;
+			continue;
+		}
+
+		{
+			auto lock = TraceLock(set->events->mtx, "EventList::mtx");
+
+			set->events->ClearEvents([&s](EventPtr e) {
+				return e->type == EventType::TET_BADFRAME || !s.shard.InRange(e->time);
+			});
+
+			vector<EventPtr> events;
+			s.events->GetEvents(0, 0, events);
+
+			for (auto& e : events)
+				set->events->AddEvent(e);
+		}
+
+		bool last = s.shard.id + 1 == shards.size() || shards.at(s.shard.id + 1).shard.setIndex != s.shard.setIndex;
+		if (last && s.timeEnd > 0)
+			set->timeEnd = s.timeEnd;
+
+		json setup = set->GetSetup();
+		if (!set->checkpoints->Matches(setup))
+			set->checkpoints->Reset(setup);
+
+		for (auto& c : s.checkpoints)
+			set->checkpoints->Add(Checkpoint::Unserialize(c));
+	}
+
+	return ok;
+}
+
+bool ShardCoordinator::Run(string self)
+{
+	MakeShards();
+
+	if (shards.empty())
+	{
+		cout << "No tracking sets in " << project.GetConfigPath() << endl;
+		return false;
+	}
+
+	LineSocket server;
+	if (!server.Listen(options.port))
+	{
+		cout << "Cannot listen on port " << options.port << endl;
+		return false;
+	}
+
+	int port = server.GetPort();
+	cout << "Coordinating " << shards.size() << " shards of " << project.sets.size() << " sets on port " << port << endl;
+
+	auto start = steady_clock::now();
+
+	launchers = options.localWorkers;
+	for (int i = 0; i < options.localWorkers; i++)
+		threads.emplace_back([this, self, port]() { LaunchWorker(self, port); });
+
+	auto idleSince = steady_clock::now();
+
+	while (!AllFinished())
+	{
+		LineSocket socket;
+		if (server.Accept(socket, 500))
+		{
+			{
+				lock_guard<mutex> lock(mtx);
+				connections++;
+			}
+
+			threads.emplace_back([this, s = move(socket)]() mutable {
+				Serve(move(s));
+
+				lock_guard<mutex> lock(mtx);
+				connections--;
+			});
+
+			continue;
+		}
+
+		if (HasWorkers())
+		{
+			idleSince = steady_clock::now();
+		}
+		else if (steady_clock::now() - idleSince > milliseconds(options.workerTimeout))
+		{
+			cout << "No worker for " << options.workerTimeout / 1000 << "s, giving up on the remaining shards" << endl;
+			FailPending();
+			break;
+		}
+	}
+
+	server.Close();
+
+	for (auto& t : threads)
+		t.join();
+
+	threads.clear();
+
+	bool ok = Merge();
+
+	project.Save();
+	project.SaveFunscript();
+
+	double seconds = duration_cast<chrono::milliseconds>(steady_clock::now() - start).count() / 1000.0;
+	cout << "Merged " << shards.size() << " shards in " << seconds << "s" << endl;
+
+	return ok;
+}
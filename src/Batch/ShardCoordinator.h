@@ -0,0 +1,90 @@
+#pragma once
+
+#include "Shard.h"
+#include "Model/Project.h"
+#include "Net/LineSocket.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct CoordinatorOptions
+{
+	// 0 picks a free port
+	int port = 0;
+	// Workers started on this machine, more can connect from others with --worker host:port
+	int localWorkers = 2;
+	// Sets are split at checkpoints at least this far apart, 0 keeps every set in one shard
+	time_t shardLength = 0;
+	// Tries per shard before its range keeps the old results, also the restarts of each local worker
+	int maxAttempts = 2;
+	// Gives up on the remaining shards after this long in ms without a worker connected or starting
+	int workerTimeout = 30000;
+	// Drops a worker that sent nothing about its shard for this long in ms, the attempt counts as failed
+	int progressTimeout = 60000;
+	int stride = 1;
+	double gate = -1;
+};
+
+enum class ShardStatus
+{
+	PENDING,
+	RUNNING,
+	DONE,
+	FAILED
+};
+
+struct ShardState
+{
+	Shard shard;
+	ShardStatus status = ShardStatus::PENDING;
+	int attempts = 0;
+	// Fragments of the current attempt
+	EventListPtr events;
+	json checkpoints;
+	time_t timeEnd = 0;
+	int frames = 0;
+};
+
+// Splits the sets of a project into shards, hands them to worker processes and merges what they send back.
+// Shards are merged in set and time order once all are finished, so the result does not depend on which
+// worker finished first. A worker that crashes only costs the shard it was on, which is handed out again.
+class ShardCoordinator
+{
+public:
+	ShardCoordinator(std::string video, CoordinatorOptions options);
+
+	// self is the binary the local workers are started from
+	bool Run(std::string self);
+
+	Project project;
+
+protected:
+	void MakeShards();
+	// Starts a local worker again when it fails while there are shards left, maxAttempts times at most
+	void LaunchWorker(std::string self, int port);
+	// True while a worker is connected or a local one is being started
+	bool HasWorkers();
+	// Shards nobody is left to track keep the old results
+	void FailPending();
+	void Serve(LineSocket socket);
+	// Next pending shard, -1 once all are finished. Waits while the remaining ones run elsewhere, they may fail
+	int TakeShard();
+	void AddFragment(int index, json& events);
+	void FinishShard(int index, json& done);
+	bool AllFinished();
+	bool Merge();
+
+	CoordinatorOptions options;
+	std::vector<ShardState> shards;
+	// Serialized once, shards of the same set share it
+	std::vector<json> setMessages;
+
+	std::mutex mtx;
+	std::condition_variable cv;
+	int connections = 0;
+	int launchers = 0;
+	std::vector<std::thread> threads;
+};
@@ -0,0 +1,231 @@
+#include "ShardWorker.h"
+#include "Model/TrackingRunner.h"
+#include "Model/Bidirectional.h"
+#include "Diagnostics/Trace.h"
+
+#include <chrono>
+#include <iostream>
+#include <limits>
+
+using namespace std;
+using namespace chrono;
+
+ShardWorker::ShardWorker(string coordinator)
+	:coordinator(coordinator)
+{
+
+}
+
+bool ShardWorker::Run()
+{
+	string host;
+	int port;
+	if (!LineSocket::ParseAddress(coordinator, host, port))
+	{
+		cout << "Expected the coordinator as host:port, got " << coordinator << endl;
+		return false;
+	}
+
+	if (!socket.Connect(host, port))
+	{
+		cout << "Cannot connect to " << coordinator << endl;
+		return false;
+	}
+
+	socket.Send({ { "type", "hello" } });
+
+	json message;
+	while (socket.Receive(message))
+	{
+		string type = message.value("type", "");
+		if (type == "quit")
+			return true;
+
+		if (type != "shard")
+			continue;
+
+		json done = { { "type", "done" }, { "id", message["id"] } };
+		bool ok = false;
+
+		try {
+			ok = TrackShard(message, done);
+		}
+		catch (const char* e) {
+			cout << "Shard " << message["id"] << " failed: " << e << endl;
+		}
+
+		done["ok"] = ok;
+		if (!socket.Send(done))
+			return false;
+	}
+
+	return false;
+}
+
+bool ShardWorker::TrackShard(json& message, json& done)
+{
+	Shard shard;
+	shard.id = message["id"];
+	shard.from = message["from"];
+	shard.to = message["to"];
+
+	string video = message["video"];
+	TrackingSetPtr set = TrackingSet::Unserialize(message["set"]);
+
+	sentUpTo = shard.from - 1;
+
+	cout << "Shard " << shard.id << ": set " << set->timeStart << " from " << shard.from << " to " << shard.to << endl;
+
+	bool ok = set->IsBidirectional()
+		? TrackBidirectional(set, shard, video, message, done)
+		: TrackForward(set, shard, video, message, done);
+
+	if (!ok)
+		return false;
+
+	if (!SendEvents(shard, *set->events, numeric_limits<time_t>::max()))
+		return false;
+
+	done["time_end"] = set->timeEnd;
+	done["checkpoints"] = json::array();
+
+	// The coordinator keeps them so later runs can split the set at them
+	for (auto t : set->checkpoints->Times())
+		if (shard.InRange(t))
+			set->checkpoints->GetBefore(t)->Serialize(done["checkpoints"][done["checkpoints"].size()]);
+
+	return true;
+}
+
+bool ShardWorker::TrackForward(TrackingSetPtr set, Shard& shard, string video, json& message, json& done)
+{
+	TrackingRunner runner(video, set, nullptr, true);
+	runner.SetTimeLimit(shard.to);
+	runner.SetStride(message.value("stride", 1));
+
+	double gate = message.value("gate", -1.0);
+	if (gate >= 0)
+		runner.SetMotionGate(gate);
+
+	// Without a matching checkpoint the runner tracks from the set start, only the shard's range is sent
+	if (shard.from > set->timeStart)
+		runner.SetResume(shard.from);
+
+	if (!runner.Setup())
+		return false;
+
+	runner.SetRunning(true);
+
+	auto lastSent = steady_clock::now();
+	RunnerState state = runner.GetState();
+
+	while (!state.finished)
+	{
+		runner.WaitFrame(500ms);
+		state = runner.GetState();
+
+		// Everything up to the last calculated frame is final
+		if (steady_clock::now() - lastSent >= chrono::milliseconds(fragmentIntervalMs))
+		{
+			if (!SendEvents(shard, *set->events, state.lastTime) || !SendProgress(shard, state.framesTotal))
+				return false;
+
+			lastSent = steady_clock::now();
+		}
+	}
+
+	runner.SetRunning(false);
+
+	done["frames"] = state.framesTotal;
+	return true;
+}
+
+bool ShardWorker::TrackBidirectional(TrackingSetPtr set, Shard& shard, string video, json& message, json& done)
+{
+	TrackingSetPtr forwardSet = MakePassSet(set, false);
+	TrackingSetPtr backwardSet = MakePassSet(set, true);
+
+	int stride = message.value("stride", 1);
+	double gate = message.value("gate", -1.0);
+
+	// Past the anchors the forward pass goes on alone to the end of the shard, see BatchTracker::TrackSetBidirectional
+	TrackingRunner forward(video, forwardSet, nullptr, true);
+	forward.SetTimeLimit(shard.to);
+	forward.SetStride(stride);
+
+	TrackingRunner backward(video, backwardSet, nullptr, true, false, true);
+	backward.SetTimeLimit(set->timeStart);
+	backward.SetStride(stride);
+
+	if (gate >= 0)
+	{
+		forward.SetMotionGate(gate);
+		backward.SetMotionGate(gate);
+	}
+
+	if (!forward.Setup() || !backward.Setup())
+		return false;
+
+	forward.SetRunning(true);
+	backward.SetRunning(true);
+
+	auto lastSent = steady_clock::now();
+
+	while (!forward.GetState().finished || !backward.GetState().finished)
+	{
+		if (!forward.GetState().finished)
+			forward.WaitFrame(500ms);
+		else
+			backward.WaitFrame(500ms);
+
+		if (steady_clock::now() - lastSent >= chrono::milliseconds(fragmentIntervalMs))
+		{
+			if (!SendProgress(shard, forward.GetState().framesTotal + backward.GetState().framesTotal))
+				return false;
+
+			lastSent = steady_clock::now();
+		}
+	}
+
+	forward.SetRunning(false);
+	backward.SetRunning(false);
+
+	// Results only exist once both passes are merged, they go back in one fragment
+	MergePasses(set, *forwardSet->events, *backwardSet->events);
+
+	done["frames"] = forward.GetState().framesTotal + backward.GetState().framesTotal;
+	return true;
+}
+
+bool ShardWorker::SendProgress(Shard& shard, int frames)
+{
+	return socket.Send({ { "type", "progress" }, { "id", shard.id }, { "frames", frames } });
+}
+
+bool ShardWorker::SendEvents(Shard& shard, EventList& events, time_t upTo)
+{
+	json fragment = { { "type", "events" }, { "id", shard.id }, { "events", json::array() } };
+
+	{
+		auto lock = TraceLock(events.mtx, "EventList::mtx");
+
+		vector<EventPtr> list;
+		events.GetEvents(sentUpTo + 1, upTo, list);
+
+		for (auto& e : list)
+		{
+			// Bad frames are marked by the user on the coordinator
+			if (e->time <= sentUpTo || !shard.InRange(e->time) || e->type == EventType::TET_BADFRAME)
+				continue;
+
+			e->Serialize(fragment["events"][fragment["events"].size()]);
+		}
+	}
+
+	sentUpTo = max(sentUpTo, upTo);
+
+	if (fragment["events"].empty())
+		return true;
+
+	return socket.Send(fragment);
+}
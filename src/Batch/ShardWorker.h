@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Shard.h"
+#include "Model/TrackingSet.h"
+#include "Net/LineSocket.h"
+
+#include <string>
+
+// Tracks the shards a coordinator hands out and streams the results back, see Shard.h
+class ShardWorker
+{
+public:
+	// Address of the coordinator as host:port
+	ShardWorker(std::string coordinator);
+
+	// Runs until the coordinator has no shards left, false when the connection broke
+	bool Run();
+
+protected:
+	bool TrackShard(json& message, json& done);
+	bool TrackForward(TrackingSetPtr set, Shard& shard, std::string video, json& message, json& done);
+	bool TrackBidirectional(TrackingSetPtr set, Shard& shard, std::string video, json& message, json& done);
+	// Sends the events of the shard after the last sent ones up to this time
+	bool SendEvents(Shard& shard, EventList& events, time_t upTo);
+	// Tells the coordinator the shard is still being tracked, also when there were no new events
+	bool SendProgress(Shard& shard, int frames);
+
+	std::string coordinator;
+	LineSocket socket;
+	time_t sentUpTo = 0;
+
+	// Wall time between event fragments and progress messages while tracking
+	static const int fragmentIntervalMs = 1000;
+};
@@ -0,0 +1,247 @@
+#include "TrackerProbe.h"
+#include "Reader/VideoReader.h"
+#include "Pipeline/WorkerPool.h"
+#include "Diagnostics/Metrics.h"
+
+#include <magic_enum.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+using namespace std;
+using namespace cv;
+using namespace chrono;
+
+TrackerProbe::TrackerProbe(string video, int frames)
+	:video(video), numFrames(max(2, frames))
+{
+
+}
+
+bool TrackerProbe::ReadFrames(TrackingSetPtr set)
+{
+	if (framesFrom == set->timeStart && !frames.empty())
+		return true;
+
+	frames.clear();
+	framesFrom = set->timeStart;
+
+	auto reader = VideoReader::create(video);
+	reader->Seek(set->timeStart);
+
+	time_t end = set->timeEnd > set->timeStart ? set->timeEnd : reader->GetDuration();
+
+	try
+	{
+		while (frames.size() < numFrames)
+		{
+			// Seeking lands on the keyframe before the start
+			cuda::GpuMat frame = reader->NextFrame();
+			time_t time = reader->GetPosition();
+
+			if (time < set->timeStart)
+				continue;
+
+			if (time > end)
+				break;
+
+			if (set->events->GetEvent(time, EventType::TET_BADFRAME))
+				continue;
+
+			frames.push_back(frame);
+		}
+	}
+	catch (...)
+	{
+		// End of the video
+	}
+
+	return frames.size() >= 2;
+}
+
+void TrackerProbe::Probe(TrackingTarget& target, TrackerScore& score, vector<Point>& centers)
+{
+	TrackerJTStruct s = GetTracker(score.tracker);
+	Rect box = target.InitialBox();
+	double targetSize = max(1, max(box.width, box.height));
+	Point start = (box.tl() + box.br()) / 2;
+
+	unique_ptr<TrackingStatus> state(target.InitTracking(s.trackingType));
+	unique_ptr<TrackerJT> tracker(s.Create(target, *state));
+	tracker->init(frames.front());
+	centers.push_back(start);
+
+	double ms = 0;
+	for (size_t i = 1; i < frames.size(); i++)
+	{
+		auto t = steady_clock::now();
+		bool ok = tracker->update(frames.at(i));
+		ms += duration<double, milli>(steady_clock::now() - t).count();
+
+		if (!ok || !state->active)
+		{
+			score.lost = true;
+			break;
+		}
+
+		centers.push_back(state->center);
+	}
+
+	score.ms = ms / (frames.size() - 1);
+	if (score.lost)
+		return;
+
+	// Start over from the result on the last frame and track back to the first
+	unique_ptr<TrackerJT> back(s.Create(target, *state));
+	back->init(frames.back());
+
+	for (size_t i = frames.size() - 1; i-- > 0;)
+	{
+		if (!back->update(frames.at(i)) || !state->active)
+		{
+			score.lost = true;
+			return;
+		}
+	}
+
+	score.forwardBackward = norm(state->center - start) / targetSize;
+}
+
+bool TrackerProbe::Run(TrackingSetPtr set, TrackingTarget& target)
+{
+	static atomic<int64_t>& probed = METRICS->Counter("probe.targets");
+
+	if (!ReadFrames(set))
+		return false;
+
+	vector<TrackerScore> scores;
+	for (auto& type : magic_enum::enum_values<TrackerJTType>())
+	{
+		auto s = GetTracker(type);
+		if (s.type == TrackerJTType::TRACKER_TYPE_UNKNOWN || !target.SupportsTrackingType(s.trackingType))
+			continue;
+
+		scores.emplace_back();
+		scores.back().tracker = type;
+	}
+
+	if (scores.empty())
+		return false;
+
+	probed++;
+
+	// Every tracker gets its own state, they only share the decoded frames
+	vector<vector<Point>> centers(scores.size());
+	vector<PoolTask> tasks;
+	for (size_t i = 0; i < scores.size(); i++)
+	{
+		tasks.push_back([this, &target, &scores, &centers, i]() {
+			try
+			{
+				Probe(target, scores.at(i), centers.at(i));
+			}
+			catch (...)
+			{
+				scores.at(i).lost = true;
+			}
+		});
+	}
+
+	WORKER_POOL->RunAll(tasks);
+
+	// Consensus is the median centre of the trackers that held on, robust to a few of them drifting together
+	Rect box = target.InitialBox();
+	double targetSize = max(1, max(box.width, box.height));
+
+	vector<Point> consensus;
+	for (size_t f = 0; f < frames.size(); f++)
+	{
+		vector<int> xs, ys;
+		for (size_t i = 0; i < scores.size(); i++)
+		{
+			if (scores.at(i).lost)
+				continue;
+
+			xs.push_back(centers.at(i).at(f).x);
+			ys.push_back(centers.at(i).at(f).y);
+		}
+
+		if (xs.empty())
+			break;
+
+		nth_element(xs.begin(), xs.begin() + xs.size() / 2, xs.end());
+		nth_element(ys.begin(), ys.begin() + ys.size() / 2, ys.end());
+		consensus.emplace_back(xs.at(xs.size() / 2), ys.at(ys.size() / 2));
+	}
+
+	TrackerScore* best = nullptr;
+	for (size_t i = 0; i < scores.size(); i++)
+	{
+		auto& s = scores.at(i);
+		if (s.lost)
+			continue;
+
+		double sum = 0;
+		for (size_t f = 0; f < consensus.size(); f++)
+			sum += norm(centers.at(i).at(f) - consensus.at(f));
+
+		s.disagreement = sum / consensus.size() / targetSize;
+		s.passed = s.forwardBackward <= maxForwardBackward && s.disagreement <= maxDisagreement;
+	}
+
+	// Cheapest one that passed, otherwise the one that came closest
+	for (auto& s : scores)
+	{
+		if (s.lost)
+			continue;
+
+		if (!best)
+		{
+			best = &s;
+			continue;
+		}
+
+		if (s.passed != best->passed)
+		{
+			if (s.passed)
+				best = &s;
+		}
+		else if (s.passed ? s.ms < best->ms : s.forwardBackward + s.disagreement < best->forwardBackward + best->disagreement)
+		{
+			best = &s;
+		}
+	}
+
+	target.trackerScores = scores;
+
+	if (!best)
+		return false;
+
+	target.preferredTracker = best->tracker;
+	return true;
+}
+
+void TrackerProbe::PrintScores(TrackingTarget& target)
+{
+	for (auto& s : target.trackerScores)
+	{
+		cout << (s.tracker == target.preferredTracker ? "* " : "  ")
+			<< setw(20) << left << GetTracker(s.tracker).name << right;
+
+		if (s.lost)
+		{
+			cout << "  lost" << endl;
+			continue;
+		}
+
+		cout << fixed << setprecision(2)
+			<< "  mean " << setw(7) << s.ms << "ms"
+			<< "  fb " << setw(5) << s.forwardBackward
+			<< "  disagree " << setw(5) << s.disagreement
+			<< (s.passed ? "  ok" : "")
+			<< endl;
+	}
+}
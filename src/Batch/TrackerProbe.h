@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Model/TrackingSet.h"
+#include "Tracking/Trackers.h"
+
+#include <opencv2/core/cuda.hpp>
+#include <string>
+#include <vector>
+
+// Picks a tracker for a target by running every applicable one on the first frames of its set.
+// A tracker is good enough when it comes back to the start after tracking to the last frame and back,
+// and stays close to what the others see. The cheapest good one wins.
+class TrackerProbe
+{
+public:
+	TrackerProbe(std::string video, int frames = defaultFrames);
+
+	// Stores the scores in the target and sets its preferredTracker, false when no tracker held on
+	bool Run(TrackingSetPtr set, TrackingTarget& target);
+	void PrintScores(TrackingTarget& target);
+
+	static const int defaultFrames = 30;
+	// Errors are in target sizes
+	static constexpr double maxForwardBackward = 0.25;
+	static constexpr double maxDisagreement = 0.25;
+
+protected:
+	bool ReadFrames(TrackingSetPtr set);
+	// Fills in time and errors of the score, centers gets the forward result of every frame
+	void Probe(TrackingTarget& target, TrackerScore& score, std::vector<cv::Point>& centers);
+
+	std::string video;
+	int numFrames;
+	std::vector<cv::cuda::GpuMat> frames;
+	time_t framesFrom = -1;
+};
@@ -0,0 +1,153 @@
+#include "TrackerReplay.h"
+#include "Model/TrackingSet.h"
+
+#include <magic_enum.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+using namespace std;
+using namespace chrono;
+
+// ReplayResult
+
+double ReplayResult::Percentile(double p)
+{
+	if (frameMs.empty())
+		return 0;
+
+	vector<double> sorted = frameMs;
+	sort(sorted.begin(), sorted.end());
+
+	size_t i = min(sorted.size() - 1, (size_t)(p * sorted.size()));
+	return sorted.at(i);
+}
+
+double ReplayResult::Mean()
+{
+	if (frameMs.empty())
+		return 0;
+
+	double sum = 0;
+	for (auto ms : frameMs)
+		sum += ms;
+
+	return sum / frameMs.size();
+}
+
+// TrackerReplay
+
+TrackerReplay::TrackerReplay(string file)
+	:replay(file)
+{
+
+}
+
+bool TrackerReplay::Run(TrackerJTType type, ReplayResult& out)
+{
+	TrackingSetPtr set = replay.GetSet();
+	TrackerJTStruct s = GetTracker(type);
+
+	out.type = type;
+	out.name = s.name;
+
+	if (s.type == TrackerJTType::TRACKER_TYPE_UNKNOWN)
+		return false;
+
+	set->events = make_unique<EventList>();
+
+	vector<unique_ptr<TrackingStatus>> states;
+	vector<unique_ptr<TrackerJT>> trackers;
+
+	for (auto& t : set->targets)
+	{
+		if (!t.SupportsTrackingType(s.trackingType))
+			continue;
+
+		states.emplace_back(t.InitTracking(s.trackingType));
+		trackers.emplace_back(s.Create(t, *states.back()));
+	}
+
+	out.trackers = trackers.size();
+	if (trackers.size() == 0)
+		return false;
+
+	replay.Rewind();
+
+	RecordedFrame f;
+	if (!replay.Next(f))
+		return false;
+
+	for (auto& t : trackers)
+		t->init(f.frame);
+
+	while (replay.Next(f))
+	{
+		double ms = 0;
+
+		for (int i = 0; i < trackers.size(); i++)
+		{
+			auto start = steady_clock::now();
+
+			if (!trackers.at(i)->update(f.frame))
+				out.failures++;
+
+			ms += duration<double, milli>(steady_clock::now() - start).count();
+			states.at(i)->SnapResult(set->events, f.time);
+		}
+
+		out.frameMs.push_back(ms);
+		out.frames++;
+	}
+
+	set->events->Serialize(out.events);
+	return true;
+}
+
+bool TrackerReplay::RunAll(vector<TrackerJTType> types, string eventsFile)
+{
+	if (types.empty())
+	{
+		for (auto& t : magic_enum::enum_values<TrackerJTType>())
+			if (t != TrackerJTType::TRACKER_TYPE_UNKNOWN)
+				types.push_back(t);
+	}
+
+	json events;
+	bool ok = false;
+
+	for (auto type : types)
+	{
+		ReplayResult r;
+		if (!Run(type, r))
+			continue;
+
+		PrintResult(r);
+		events[r.name]["frame_ms"] = r.frameMs;
+		events[r.name]["events"] = r.events;
+		ok = true;
+	}
+
+	if (!eventsFile.empty())
+	{
+		ofstream o(eventsFile);
+		o << setw(4) << events << endl;
+	}
+
+	return ok;
+}
+
+void TrackerReplay::PrintResult(ReplayResult& r)
+{
+	cout << setw(20) << left << r.name << right
+		<< "  trackers " << r.trackers
+		<< "  frames " << setw(6) << r.frames
+		<< "  failed " << setw(5) << r.failures
+		<< fixed << setprecision(2)
+		<< "  mean " << setw(7) << r.Mean() << "ms"
+		<< "  p50 " << setw(7) << r.Percentile(0.5) << "ms"
+		<< "  p99 " << setw(7) << r.Percentile(0.99) << "ms"
+		<< endl;
+}
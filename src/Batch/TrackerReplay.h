@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Tracking/FrameRecording.h"
+
+#include <string>
+#include <vector>
+
+struct ReplayResult
+{
+	TrackerJTType type = TrackerJTType::TRACKER_TYPE_UNKNOWN;
+	std::string name;
+	int trackers = 0;
+	int frames = 0;
+	int failures = 0;
+
+	// Time spent in update for every frame, summed over the targets
+	std::vector<double> frameMs;
+	json events;
+
+	double Percentile(double p);
+	double Mean();
+};
+
+// Feeds a recording to trackers without decoder or window, so runs on the same input can be compared
+class TrackerReplay
+{
+public:
+	TrackerReplay(std::string file);
+
+	bool IsOpen() { return replay.IsOpen(); };
+	bool Run(TrackerJTType type, ReplayResult& out);
+
+	// Every type when empty
+	bool RunAll(std::vector<TrackerJTType> types, std::string eventsFile = "");
+	void PrintResult(ReplayResult& r);
+
+protected:
+	FrameReplay replay;
+};
@@ -0,0 +1,324 @@
+#include "TrackerSweep.h"
+#include "Pipeline/WorkerPool.h"
+
+#include <magic_enum.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+using namespace std;
+using namespace cv;
+using namespace chrono;
+
+TrackerSweep::TrackerSweep(string file)
+	:replay(file)
+{
+
+}
+
+vector<json> TrackerSweep::Expand(json& params)
+{
+	vector<json> out = { json::object() };
+
+	for (auto& p : params.items())
+	{
+		json values = p.value().is_array() ? p.value() : json::array({ p.value() });
+
+		vector<json> next;
+		for (auto& config : out)
+		{
+			for (auto& v : values)
+			{
+				next.push_back(config);
+				next.back()[p.key()] = v;
+			}
+		}
+
+		out = next;
+	}
+
+	return out;
+}
+
+bool TrackerSweep::LoadFrames(time_t from, time_t to)
+{
+	frames.clear();
+	replay.Rewind();
+	scoreFrom = 0;
+
+	// The frames before from are still tracked, the initial boxes belong to the first one
+	RecordedFrame f;
+	while (replay.Next(f))
+	{
+		if (to > 0 && f.time > to)
+			break;
+
+		if (f.time < from)
+			scoreFrom = frames.size() + 1;
+
+		frames.push_back(f);
+		f = RecordedFrame();
+	}
+
+	// The first frame only initializes, at least one frame has to be scored
+	scoreFrom = max<size_t>(scoreFrom, 1);
+	return frames.size() > scoreFrom;
+}
+
+void TrackerSweep::Replay(TrackerJTType tracker, json params, vector<vector<Point>>& centers, SweepResult& out)
+{
+	TrackerJTStruct s = GetTracker(tracker);
+	string name(magic_enum::enum_name(tracker));
+
+	// Copies so the configurations running next to each other do not share parameters
+	vector<unique_ptr<TrackingTarget>> copies;
+	vector<unique_ptr<TrackingStatus>> states;
+	vector<unique_ptr<TrackerJT>> trackers;
+
+	centers.assign(targets.size(), vector<Point>());
+
+	for (size_t i = 0; i < targets.size(); i++)
+	{
+		copies.push_back(make_unique<TrackingTarget>(*targets.at(i)));
+		if (!params.is_null())
+			copies.back()->trackerParams[name] = params;
+
+		Rect box = copies.back()->InitialBox();
+		centers.at(i).push_back((box.tl() + box.br()) / 2);
+
+		states.emplace_back(copies.back()->InitTracking(s.trackingType));
+		trackers.emplace_back(s.Create(*copies.back(), *states.back()));
+	}
+
+	HostFrame first = frames.front().frame;
+	for (auto& t : trackers)
+		t->init(first);
+
+	double ms = 0;
+	for (size_t f = 1; f < frames.size(); f++)
+	{
+		// Variants are added to the copy, the recorded frame stays shared
+		HostFrame frame = frames.at(f).frame;
+		bool scored = f >= scoreFrom;
+
+		for (size_t i = 0; i < trackers.size(); i++)
+		{
+			auto start = steady_clock::now();
+
+			bool failed = !trackers.at(i)->update(frame) || !states.at(i)->active;
+
+			if (scored)
+			{
+				out.failures += failed ? 1 : 0;
+				ms += duration<double, milli>(steady_clock::now() - start).count();
+			}
+
+			centers.at(i).push_back(states.at(i)->center);
+		}
+	}
+
+	out.ms = ms / (frames.size() - scoreFrom);
+}
+
+bool TrackerSweep::Run(json& grid)
+{
+	auto t = magic_enum::enum_cast<TrackerJTType>((string)grid.value("tracker", ""));
+	if (!t.has_value() || GetTracker(t.value()).type == TrackerJTType::TRACKER_TYPE_UNKNOWN)
+	{
+		cout << "Unknown tracker " << grid.value("tracker", "") << endl;
+		return false;
+	}
+
+	type = t.value();
+
+	if (grid.contains("reference"))
+	{
+		auto r = magic_enum::enum_cast<TrackerJTType>((string)grid["reference"]);
+		if (!r.has_value() || GetTracker(r.value()).type == TrackerJTType::TRACKER_TYPE_UNKNOWN)
+		{
+			cout << "Unknown reference tracker " << grid["reference"] << endl;
+			return false;
+		}
+
+		referenceType = r.value();
+	}
+
+	maxError = grid.value("max_error", maxError);
+
+	if (!LoadFrames(grid.value("from", (time_t)0), grid.value("to", (time_t)0)))
+	{
+		cout << "Not enough frames in the range" << endl;
+		return false;
+	}
+
+	TrackingSetPtr set = replay.GetSet();
+	auto trackingType = GetTracker(type).trackingType;
+	auto referenceTracking = GetTracker(referenceType).trackingType;
+
+	targets.clear();
+	targetSizes.clear();
+	for (auto& target : set->targets)
+	{
+		if (!target.SupportsTrackingType(trackingType) || !target.SupportsTrackingType(referenceTracking))
+			continue;
+
+		Rect box = target.InitialBox();
+		targets.push_back(&target);
+		targetSizes.push_back(max(1, max(box.width, box.height)));
+	}
+
+	if (targets.empty())
+	{
+		cout << "No target supports both trackers" << endl;
+		return false;
+	}
+
+	SweepResult referenceResult;
+	Replay(referenceType, json(), reference, referenceResult);
+
+	json params = grid.contains("params") ? grid["params"] : json::object();
+	vector<json> configs = Expand(params);
+
+	results.assign(configs.size(), SweepResult());
+
+	vector<PoolTask> tasks;
+	for (size_t c = 0; c < configs.size(); c++)
+	{
+		tasks.push_back([this, &configs, c]() {
+			SweepResult& r = results.at(c);
+			r.params = configs.at(c);
+
+			vector<vector<Point>> centers;
+			Replay(type, r.params, centers, r);
+
+			double sum = 0;
+			int count = 0;
+			for (size_t i = 0; i < centers.size(); i++)
+			{
+				for (size_t f = scoreFrom; f < centers.at(i).size(); f++)
+				{
+					sum += norm(centers.at(i).at(f) - reference.at(i).at(f)) / targetSizes.at(i);
+					count++;
+				}
+			}
+
+			r.error = count > 0 ? sum / count : 0;
+		});
+	}
+
+	WORKER_POOL->RunAll(tasks);
+
+	MarkPareto();
+	return true;
+}
+
+void TrackerSweep::MarkPareto()
+{
+	for (auto& r : results)
+	{
+		r.pareto = none_of(results.begin(), results.end(), [&r](SweepResult& o) {
+			return o.ms <= r.ms && o.error <= r.error && (o.ms < r.ms || o.error < r.error);
+		});
+	}
+
+	sort(results.begin(), results.end(), [](SweepResult& a, SweepResult& b) {
+		return a.ms < b.ms;
+	});
+}
+
+SweepResult* TrackerSweep::Pick()
+{
+	SweepResult* best = nullptr;
+
+	// Sorted by time, the first one accurate enough is the fastest
+	for (auto& r : results)
+		if (r.pareto && r.error <= maxError)
+			return &r;
+
+	for (auto& r : results)
+		if (r.pareto && (!best || r.error < best->error))
+			best = &r;
+
+	return best;
+}
+
+bool TrackerSweep::Apply(Project& project)
+{
+	SweepResult* picked = Pick();
+	if (!picked)
+		return false;
+
+	TrackingSetPtr recorded = replay.GetSet();
+	auto it = find_if(project.sets.begin(), project.sets.end(), [&recorded](TrackingSetPtr& s) {
+		return s->timeStart == recorded->timeStart;
+	});
+
+	if (it == project.sets.end())
+	{
+		cout << "No set at " << recorded->timeStart << " in " << project.GetConfigPath() << endl;
+		return false;
+	}
+
+	string name(magic_enum::enum_name(type));
+	int applied = 0;
+
+	for (auto target : targets)
+	{
+		for (auto& t : (*it)->targets)
+		{
+			if (t.GetGuid() != target->GetGuid())
+				continue;
+
+			t.trackerParams[name] = picked->params;
+			applied++;
+		}
+	}
+
+	cout << "Stored " << picked->params << " for " << applied << " targets" << endl;
+	return applied > 0;
+}
+
+void TrackerSweep::PrintResults()
+{
+	cout << GetTracker(type).name << " against " << GetTracker(referenceType).name
+		<< ", " << frames.size() - scoreFrom << " of " << frames.size() << " frames scored, " << targets.size() << " targets" << endl;
+
+	SweepResult* picked = Pick();
+
+	for (auto& r : results)
+	{
+		cout << (&r == picked ? "* " : r.pareto ? "+ " : "  ")
+			<< fixed << setprecision(2)
+			<< "mean " << setw(7) << r.ms << "ms"
+			<< setprecision(3)
+			<< "  error " << setw(6) << r.error
+			<< "  failed " << setw(5) << r.failures
+			<< "  " << r.params.dump()
+			<< endl;
+	}
+}
+
+void TrackerSweep::SaveResults(string file)
+{
+	json j;
+	j["tracker"] = magic_enum::enum_name(type);
+	j["reference"] = magic_enum::enum_name(referenceType);
+	j["frames"] = frames.size();
+	j["scored"] = frames.size() - scoreFrom;
+	j["results"] = json::array();
+
+	for (auto& r : results)
+	{
+		json& o = j["results"][j["results"].size()];
+		o["params"] = r.params;
+		o["ms"] = r.ms;
+		o["error"] = r.error;
+		o["failures"] = r.failures;
+		o["pareto"] = r.pareto;
+	}
+
+	ofstream o(file);
+	o << setw(4) << j << endl;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Tracking/FrameRecording.h"
+#include "Model/Project.h"
+
+#include <opencv2/core.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct SweepResult
+{
+	json params;
+	// Mean update time per frame, summed over the targets
+	double ms = 0;
+	// Mean distance to the reference in target sizes
+	double error = 0;
+	int failures = 0;
+	bool pareto = false;
+};
+
+// Replays a recording with every configuration of a parameter grid for one tracker.
+// The grid file looks like
+//   { "tracker": "CPU_RECT_KCF", "params": { "resize": [true, false], "max_patch_size": [1600, 6400] },
+//     "reference": "CPU_RECT_CSRT", "max_error": 0.1, "from": 0, "to": 0 }
+// Accuracy is measured against the reference tracker with its defaults. Every tracker starts on the first
+// recorded frame where the targets were defined, from and to only limit the frames that are scored.
+// Configurations run at the same time on the worker pool, so times are comparable with each other but
+// higher than on an idle machine.
+class TrackerSweep
+{
+public:
+	TrackerSweep(std::string file);
+
+	bool IsOpen() { return replay.IsOpen(); };
+	bool Run(json& grid);
+	void PrintResults();
+	void SaveResults(std::string file);
+	// Fastest configuration on the front within max_error, the most accurate one if none is, nullptr before Run
+	SweepResult* Pick();
+	// Stores the picked parameters in the targets of the set the recording was taken from
+	bool Apply(Project& project);
+
+protected:
+	// Cartesian product of the value lists, a single value is a list of one
+	static std::vector<json> Expand(json& params);
+	// Frames from the start of the recording up to to, scoring starts at the first one at or after from
+	bool LoadFrames(time_t from, time_t to);
+	// Centres of every usable target on every frame, with params for the swept tracker
+	void Replay(TrackerJTType tracker, json params, std::vector<std::vector<cv::Point>>& centers, SweepResult& out);
+	void MarkPareto();
+
+	FrameReplay replay;
+	TrackerJTType type = TrackerJTType::TRACKER_TYPE_UNKNOWN;
+	TrackerJTType referenceType = CPU_RECT_CSRT;
+	double maxError = 0.1;
+
+	std::vector<RecordedFrame> frames;
+	size_t scoreFrom = 0;
+	// Targets both trackers support, with their size for the error
+	std::vector<TrackingTarget*> targets;
+	std::vector<double> targetSizes;
+	std::vector<std::vector<cv::Point>> reference;
+	std::vector<SweepResult> results;
+};
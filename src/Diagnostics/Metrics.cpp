@@ -0,0 +1,238 @@
+#include "Metrics.h"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+using namespace chrono;
+
+Metrics* METRICS = new Metrics();
+
+// LatencyHistogram
+
+void LatencyHistogram::Record(double ms)
+{
+    uint64_t us = (uint64_t)max(0.0, ms * 1000.0);
+
+    int bucket = 0;
+    while (bucket < numBuckets - 1 && us >= (1ull << bucket))
+        bucket++;
+
+    buckets[bucket]++;
+    count++;
+    sumUs += us;
+
+    uint64_t prev = maxUs;
+    while (us > prev && !maxUs.compare_exchange_weak(prev, us))
+        ;
+}
+
+void LatencyHistogram::Reset()
+{
+    for (auto& b : buckets)
+        b = 0;
+
+    count = 0;
+    sumUs = 0;
+    maxUs = 0;
+}
+
+double LatencyHistogram::BucketMs(int i)
+{
+    return (1ull << i) / 1000.0;
+}
+
+double LatencyHistogram::MeanMs()
+{
+    uint64_t c = count;
+    if (c == 0)
+        return 0;
+
+    return sumUs / (double)c / 1000.0;
+}
+
+double LatencyHistogram::PercentileMs(double p)
+{
+    uint64_t c = count;
+    if (c == 0)
+        return 0;
+
+    uint64_t wanted = (uint64_t)ceil(c * p);
+    uint64_t seen = 0;
+
+    for (int i = 0; i < numBuckets; i++)
+    {
+        seen += buckets[i];
+        if (seen >= wanted)
+            return min(BucketMs(i), MaxMs());
+    }
+
+    return MaxMs();
+}
+
+void LatencyHistogram::Serialize(json& j)
+{
+    j["count"] = Count();
+    j["mean_ms"] = MeanMs();
+    j["p50_ms"] = PercentileMs(0.5);
+    j["p90_ms"] = PercentileMs(0.9);
+    j["p99_ms"] = PercentileMs(0.99);
+    j["max_ms"] = MaxMs();
+
+    j["buckets"] = json::array();
+    for (int i = 0; i < numBuckets; i++)
+    {
+        if (buckets[i] == 0)
+            continue;
+
+        json& b = j["buckets"][j["buckets"].size()];
+        b["lt_ms"] = BucketMs(i);
+        b["count"] = buckets[i].load();
+    }
+}
+
+// Metrics
+
+Metrics::~Metrics()
+{
+    StopSampling();
+}
+
+LatencyHistogram& Metrics::Histogram(const string& name)
+{
+    lock_guard<mutex> lock(mtx);
+
+    auto& h = histograms[name];
+    if (!h)
+        h = make_unique<LatencyHistogram>();
+
+    return *h;
+}
+
+atomic<int64_t>& Metrics::Counter(const string& name)
+{
+    lock_guard<mutex> lock(mtx);
+
+    auto& c = counters[name];
+    if (!c)
+        c = make_unique<atomic<int64_t>>(0);
+
+    return *c;
+}
+
+void Metrics::SetGauge(const string& name, double value)
+{
+    lock_guard<mutex> lock(mtx);
+    gauges[name] = value;
+}
+
+void Metrics::Reset()
+{
+    lock_guard<mutex> lock(mtx);
+
+    for (auto& kv : histograms)
+        kv.second->Reset();
+
+    for (auto& kv : counters)
+        *kv.second = 0;
+
+    gauges.clear();
+}
+
+void Metrics::Serialize(json& j)
+{
+    lock_guard<mutex> lock(mtx);
+
+    j["time_ms"] = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+
+    j["histograms"] = json::object();
+    for (auto& kv : histograms)
+        kv.second->Serialize(j["histograms"][kv.first]);
+
+    j["counters"] = json::object();
+    for (auto& kv : counters)
+        j["counters"][kv.first] = kv.second->load();
+
+    j["gauges"] = json::object();
+    for (auto& kv : gauges)
+        j["gauges"][kv.first] = kv.second;
+}
+
+string Metrics::ToCsv()
+{
+    lock_guard<mutex> lock(mtx);
+    stringstream out;
+
+    out << "kind,name,count,mean_ms,p50_ms,p90_ms,p99_ms,max_ms,value" << endl;
+
+    for (auto& kv : histograms)
+    {
+        auto& h = *kv.second;
+        out << "histogram," << kv.first << "," << h.Count() << "," << h.MeanMs() << "," << h.PercentileMs(0.5) << ","
+            << h.PercentileMs(0.9) << "," << h.PercentileMs(0.99) << "," << h.MaxMs() << "," << endl;
+    }
+
+    for (auto& kv : counters)
+        out << "counter," << kv.first << ",,,,,,," << kv.second->load() << endl;
+
+    for (auto& kv : gauges)
+        out << "gauge," << kv.first << ",,,,,,," << kv.second << endl;
+
+    return out.str();
+}
+
+bool Metrics::Dump(const string& file)
+{
+    ofstream o(file);
+    if (o.fail())
+        return false;
+
+    if (file.size() > 4 && file.substr(file.size() - 4) == ".csv")
+    {
+        o << ToCsv();
+    }
+    else
+    {
+        json j;
+        Serialize(j);
+        o << setw(4) << j << endl;
+    }
+
+    return true;
+}
+
+void Metrics::StartSampling(const string& file, int intervalMs)
+{
+    StopSampling();
+
+    sampling = true;
+    samplingThread = thread(&Metrics::RunSampling, this, file, intervalMs);
+}
+
+void Metrics::StopSampling()
+{
+    {
+        lock_guard<mutex> lock(samplingMtx);
+        sampling = false;
+    }
+    samplingCv.notify_all();
+
+    if (samplingThread.joinable())
+        samplingThread.join();
+}
+
+void Metrics::RunSampling(string file, int intervalMs)
+{
+    ofstream o(file, ios::app);
+
+    unique_lock<mutex> lock(samplingMtx);
+    while (sampling)
+    {
+        samplingCv.wait_for(lock, milliseconds(intervalMs), [this]() { return !sampling; });
+
+        json j;
+        Serialize(j);
+        o << j << endl;
+    }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <json.hpp>
+using json = nlohmann::json;
+
+// Latency distribution with fixed power of two buckets in microseconds, recording is lock free
+class LatencyHistogram
+{
+public:
+    static const int numBuckets = 27;
+
+    void Record(double ms);
+    void Reset();
+
+    uint64_t Count() { return count; };
+    double MeanMs();
+    double MaxMs() { return maxUs / 1000.0; };
+    double PercentileMs(double p);
+
+    // Upper bound of bucket i
+    static double BucketMs(int i);
+
+    void Serialize(json& j);
+
+protected:
+    std::atomic<uint64_t> buckets[numBuckets] = {};
+    std::atomic<uint64_t> count{ 0 };
+    std::atomic<uint64_t> sumUs{ 0 };
+    std::atomic<uint64_t> maxUs{ 0 };
+};
+
+class ScopedLatency
+{
+public:
+    ScopedLatency(LatencyHistogram& histogram)
+        :histogram(histogram), start(std::chrono::steady_clock::now())
+    {
+
+    }
+
+    ~ScopedLatency()
+    {
+        histogram.Record(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+protected:
+    LatencyHistogram& histogram;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Registry of named histograms, counters and gauges.
+// Lookups take a lock, call sites keep the returned reference.
+class Metrics
+{
+public:
+    ~Metrics();
+
+    LatencyHistogram& Histogram(const std::string& name);
+    std::atomic<int64_t>& Counter(const std::string& name);
+    void SetGauge(const std::string& name, double value);
+
+    void Reset();
+    void Serialize(json& j);
+    std::string ToCsv();
+
+    // Writes json, or csv when the file name ends in .csv
+    bool Dump(const std::string& file);
+
+    // Appends one json line per interval to the file until StopSampling
+    void StartSampling(const std::string& file, int intervalMs);
+    void StopSampling();
+
+protected:
+    void RunSampling(std::string file, int intervalMs);
+
+    std::mutex mtx;
+    std::map<std::string, std::unique_ptr<LatencyHistogram>> histograms;
+    std::map<std::string, std::unique_ptr<std::atomic<int64_t>>> counters;
+    std::map<std::string, double> gauges;
+
+    std::thread samplingThread;
+    std::mutex samplingMtx;
+    std::condition_variable samplingCv;
+    bool sampling = false;
+};
+
+extern Metrics* METRICS;
@@ -0,0 +1,126 @@
+#include "Trace.h"
+
+#include <fstream>
+
+using namespace std;
+using namespace chrono;
+
+Tracer* TRACER = new Tracer();
+
+static thread_local TraceBuffer* threadBuffer = nullptr;
+static thread_local string threadName;
+
+static void WriteString(ostream& o, const char* s)
+{
+    o << '"';
+    for (; *s; s++)
+    {
+        if (*s == '"' || *s == '\\')
+            o << '\\';
+
+        if ((unsigned char)*s >= 0x20)
+            o << *s;
+    }
+    o << '"';
+}
+
+void Tracer::Start()
+{
+    epoch = steady_clock::now();
+    enabled = true;
+}
+
+void Tracer::Stop()
+{
+    enabled = false;
+}
+
+int64_t Tracer::NowUs()
+{
+    return duration_cast<microseconds>(steady_clock::now() - epoch).count();
+}
+
+TraceBuffer* Tracer::GetBuffer()
+{
+    if (threadBuffer)
+        return threadBuffer;
+
+    lock_guard<mutex> lock(mtx);
+
+    auto buffer = make_shared<TraceBuffer>((int)buffers.size() + 1, bufferCapacity);
+    buffer->threadName = threadName;
+    buffers.push_back(buffer);
+
+    // The tracer keeps the buffer alive after the thread exits
+    threadBuffer = buffer.get();
+    return threadBuffer;
+}
+
+void Tracer::Record(const char* name, const char* category, int64_t startUs, int64_t durationUs)
+{
+    TraceBuffer* b = GetBuffer();
+
+    size_t n = b->count.load(memory_order_relaxed);
+    if (n >= b->events.size())
+    {
+        b->dropped++;
+        return;
+    }
+
+    b->events[n] = TraceEvent{ name, category, startUs, durationUs };
+    b->count.store(n + 1, memory_order_release);
+}
+
+void Tracer::SetThreadName(const string& name)
+{
+    threadName = name;
+
+    if (threadBuffer)
+    {
+        lock_guard<mutex> lock(TRACER->mtx);
+        threadBuffer->threadName = name;
+    }
+}
+
+bool Tracer::Write(const string& file)
+{
+    ofstream o(file);
+    if (o.fail())
+        return false;
+
+    lock_guard<mutex> lock(mtx);
+
+    o << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << endl;
+
+    bool first = true;
+    for (auto& b : buffers)
+    {
+        string name = b->threadName.empty() ? "thread " + to_string(b->tid) : b->threadName;
+
+        o << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << b->tid << ",\"args\":{\"name\":";
+        WriteString(o, name.c_str());
+        o << "}}";
+        first = false;
+
+        size_t n = b->count.load(memory_order_acquire);
+        for (size_t i = 0; i < n; i++)
+        {
+            auto& e = b->events[i];
+
+            o << ",\n{\"name\":";
+            WriteString(o, e.name);
+            o << ",\"cat\":";
+            WriteString(o, e.category);
+            o << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << b->tid << ",\"ts\":" << e.startUs << ",\"dur\":" << e.durationUs << "}";
+        }
+
+        if (b->dropped > 0)
+        {
+            o << ",\n{\"name\":\"dropped events\",\"ph\":\"C\",\"pid\":1,\"tid\":" << b->tid << ",\"ts\":" << NowUs()
+                << ",\"args\":{\"dropped\":" << b->dropped.load() << "}}";
+        }
+    }
+
+    o << "\n]}" << endl;
+    return true;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct TraceEvent
+{
+    // Names must outlive the tracer, pass literals or tracker names
+    const char* name;
+    const char* category;
+    int64_t startUs;
+    int64_t durationUs;
+};
+
+// Written by its own thread only, the writer publishes with count so dumping needs no lock
+struct TraceBuffer
+{
+    TraceBuffer(int tid, size_t capacity)
+        :tid(tid), events(capacity)
+    {
+
+    }
+
+    int tid;
+    std::string threadName;
+    std::vector<TraceEvent> events;
+    std::atomic<size_t> count{ 0 };
+    std::atomic<uint64_t> dropped{ 0 };
+};
+
+// Opt in timeline of scoped spans per thread, written as Chrome trace event json for Perfetto or chrome://tracing
+class Tracer
+{
+public:
+    void Start();
+    void Stop();
+    bool IsEnabled() { return enabled.load(std::memory_order_relaxed); };
+
+    int64_t NowUs();
+    void Record(const char* name, const char* category, int64_t startUs, int64_t durationUs);
+
+    // Label for the calling thread, static since pool threads name themselves during static initialization
+    static void SetThreadName(const std::string& name);
+
+    bool Write(const std::string& file);
+
+protected:
+    TraceBuffer* GetBuffer();
+
+    std::atomic<bool> enabled{ false };
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+    std::mutex mtx;
+    std::vector<std::shared_ptr<TraceBuffer>> buffers;
+
+    static constexpr size_t bufferCapacity = 1 << 18;
+};
+
+extern Tracer* TRACER;
+
+class TraceScope
+{
+public:
+    TraceScope(const char* name, const char* category = "span")
+        :name(name), category(category)
+    {
+        if (TRACER->IsEnabled())
+            startUs = TRACER->NowUs();
+    }
+
+    ~TraceScope()
+    {
+        if (startUs >= 0)
+            TRACER->Record(name, category, startUs, TRACER->NowUs() - startUs);
+    }
+
+protected:
+    const char* name;
+    const char* category;
+    int64_t startUs = -1;
+};
+
+// Locks the mutex and records the time spent waiting for it
+template<typename Mutex>
+std::unique_lock<Mutex> TraceLock(Mutex& m, const char* name)
+{
+    TraceScope wait(name, "lock");
+    return std::unique_lock<Mutex>(m);
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
@@ -1,6 +1,7 @@
 #include "TrackingWindow.h"
 #include "States/StatePlayer.h"
 #include "States/Set/StateEditSet.h"
+#include "Diagnostics/Trace.h"
 
 #include <OISException.h>
 #include <opencv2/cudawarping.hpp>
@@ -123,6 +124,8 @@ void TrackingWindow::UpdateElements()
 
 void TrackingWindow::ReallyDrawWindow(cuda::Stream& stream)
 {
+	TRACE_SCOPE("draw window");
+
 	if (inFrame.empty())
 		return;
 
@@ -140,7 +143,10 @@ void TrackingWindow::ReallyDrawWindow(cuda::Stream& stream)
 	}
 
 	for (auto& e : guiElements)
+	{
+		TRACE_SCOPE("draw element");
 		e.get().DoDraw(outFrame);
+	}
 
 	putText(outFrame, "State: " + s.GetName(), Point(30, 60), FONT_HERSHEY_SIMPLEX, 0.8, Scalar(0, 255, 0), 2);
 
@@ -157,6 +163,7 @@ void TrackingWindow::ReallyDrawWindow(cuda::Stream& stream)
 		gpuResizedFrame.download(outFrame);
 	}
 
+	TRACE_SCOPE("imshow");
 	imshow(windowName, outFrame);
 }
 
@@ -166,8 +173,22 @@ void TrackingWindow::SetInFrame(cv::cuda::GpuMat inFrame, bool lock)
 	this->inFrameLocked = lock;
 };
 
+void TrackingWindow::ShowFrame(cuda::GpuMat frame, time_t time)
+{
+	if (!inFrameLocked)
+		inFrame = frame;
+
+	shownTime = time;
+	UpdateTrackbar();
+	DrawWindow();
+}
+
 cv::cuda::GpuMat TrackingWindow::ReadCleanFrame(cuda::Stream& stream)
 {
+	// Continue after the frame that was shown last
+	if (shownTime > 0)
+		SetPosition(shownTime, false);
+
 	cv::cuda::GpuMat newFrame = videoReader->NextFrame(stream);
 	if (newFrame.empty())
 		throw "Reading frame failed";
@@ -193,6 +214,8 @@ cv::cuda::GpuMat TrackingWindow::ReadCleanFrame(cuda::Stream& stream)
 
 void TrackingWindow::Run()
 {
+	Tracer::SetThreadName("ui");
+
 	while (stack.HasState())
 		RunOnce();
 }
@@ -203,6 +226,8 @@ void TrackingWindow::RunOnce()
 {
 	if (!stack.HasState())
 		return;
+
+	TRACE_SCOPE("run once");
 	
 	StateBase& s = stack.GetState();
 	
@@ -222,7 +247,10 @@ void TrackingWindow::RunOnce()
 		}
 	}
 
-	s.Update();
+	{
+		TRACE_SCOPE("state update");
+		s.Update();
+	}
 
 	for (auto& e : guiElements)
 		if (e.get().DrawRequested())
@@ -237,6 +265,7 @@ void TrackingWindow::RunOnce()
 
 	inputKeyboard->capture();
 	// Do cycle processing
+	TRACE_SCOPE("wait key");
 	waitKey(1);
 }
 
@@ -298,6 +327,7 @@ void TrackingWindow::OnClick(int e, int x, int y, int f, void* p)
 
 void TrackingWindow::SetPosition(time_t position, bool updateTrackbar)
 {
+	shownTime = 0;
 	videoReader->Seek(position);
 
 	cuda::Stream stream;
@@ -314,6 +344,9 @@ void TrackingWindow::SetPosition(time_t position, bool updateTrackbar)
 
 time_t TrackingWindow::GetCurrentPosition()
 {
+	if (shownTime > 0)
+		return shownTime;
+
 	return videoReader->GetPosition();
 }
 
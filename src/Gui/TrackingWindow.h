@@ -5,6 +5,7 @@
 #include "GuiElement.h"
 #include "StateStack.h"
 #include "Model/Project.h"
+#include "Net/PositionStream.h"
 
 #include "Timebar.h"
 
@@ -24,6 +25,8 @@ public:
 	cv::cuda::GpuMat GetInFrame() { return inFrame; };
 	void SetInFrame(cv::cuda::GpuMat inFrame, bool lock);
 	cv::cuda::GpuMat ReadCleanFrame(cv::cuda::Stream& stream = cv::cuda::Stream::Null());
+	// Shows a frame decoded elsewhere, the window's reader only catches up once it reads again
+	void ShowFrame(cv::cuda::GpuMat frame, time_t time);
 
 	cv::Mat* GetOutFrame() { return &outFrame; };
 	void DrawWindow(bool updateButtons = false);
@@ -55,6 +58,8 @@ public:
 	StateStack stack;
 	Project project;
 	Timebar timebar;
+	// Positions of the sets tracked in this window go here as well, see TrackingRunner::SetLiveOutput
+	PositionStreamPtr liveOutput;
 
 	static OIS::Keyboard* inputKeyboard;
 
@@ -90,6 +95,8 @@ protected:
 	std::vector<std::reference_wrapper<GuiElement>> guiElements;
 	std::chrono::steady_clock::time_point lastSeek;
 	time_t seekPos = 0;
+	// Time of the frame from ShowFrame, 0 while the shown frame is the reader's
+	time_t shownTime = 0;
 
 	float videoScale = 1;
 };
\ No newline at end of file
@@ -1,72 +1,24 @@
 #include "Main.h"
 #include "Gui/TrackingWindow.h"
+#include "Batch/BatchTracker.h"
+#include "Batch/TrackerReplay.h"
+#include "Batch/TrackerSweep.h"
+#include "Batch/ShardCoordinator.h"
+#include "Batch/ShardWorker.h"
+#include "Batch/JobServer.h"
+#include "Net/PositionStream.h"
+#include "Diagnostics/Metrics.h"
+#include "Diagnostics/Trace.h"
 
 #include <iostream>
 #include <filesystem>
 #include <fstream>
 #include <cstring>
+#include <magic_enum.hpp>
 
 using namespace cv;
 using namespace std;
 
-Scalar myColors[] = {
-	{197, 100, 195},
-	{90, 56, 200},
-	{67, 163, 255},
-	{143, 176, 59},
-	{206, 29, 255},
-	{133, 108, 252},
-	{166, 252, 153},
-	{120, 128, 21},
-	{93, 236, 178},
-	{196, 108, 43},
-	{74, 110, 255},
-	{20, 249, 29},
-	{208, 173, 162}
-};
-
-Scalar PickColor(int index)
-{
-	if (index > sizeof(myColors))
-		index = index % sizeof(myColors);
-
-	return myColors[index];
-}
-
-string TargetTypeToString(TARGET_TYPE t)
-{
-	switch (t) {
-	case TYPE_MALE:
-		return "Male";
-	case TYPE_FEMALE:
-		return "Female";
-	case TYPE_BACKGROUND:
-		return "Background";
-	default:
-		return "Unknown";
-	}
-}
-
-string TrackingModeToString(TrackingMode m)
-{
-	switch (m) {
-	case TM_DIAGONAL:
-		return "Diagonal";
-	case TM_HORIZONTAL:
-		return "Horizontal";
-	case TM_VERTICAL:
-		return "Vertical";
-	case TM_DIAGONAL_SINGLE:
-		return "X/Y move";
-	case TM_HORIZONTAL_SINGLE:
-		return "X move";
-	case TM_VERTICAL_SINGLE:
-		return "Y move";
-	default:
-		return "None";
-	}
-}
-
 int main(int argc, char* argv[])
 {
 	cout << "Starting" << endl;
@@ -81,13 +33,305 @@ int main(int argc, char* argv[])
 		fName = argv[1];
     else {
         std::cout << "require video path as first argument" << std::endl;
+        std::cout << "usage: " << argv[0] << " <video> [--batch [--decoders n] [--memory mb] [--stride n] [--gate threshold]] [--live host:port] [--metrics file [--metrics-interval ms]] [--trace file]" << std::endl;
+        std::cout << "       " << argv[0] << " <video> --record file [--set n]" << std::endl;
+        std::cout << "       " << argv[0] << " --replay file [--tracker type] [--events file]" << std::endl;
+        std::cout << "       " << argv[0] << " --sweep file grid [--results file] [--apply video]" << std::endl;
+        std::cout << "       " << argv[0] << " <video> --coordinate [--port n] [--workers n] [--shard-length ms] [--stride n] [--gate threshold]" << std::endl;
+        std::cout << "       " << argv[0] << " --worker host:port" << std::endl;
+        std::cout << "       " << argv[0] << " --serve [--port n] [--jobs n] [--decoders n] [--memory mb]" << std::endl;
+        std::cout << "       " << argv[0] << " --submit port video [--project file] [--priority n] [--decoders n] [--memory mb] [--stride n] [--gate threshold]" << std::endl;
+        std::cout << "       " << argv[0] << " --status port | --cancel port job | --shutdown port" << std::endl;
+        std::cout << "       " << argv[0] << " --mock-device port" << std::endl;
         return 0;
     }
-	
-	TrackingWindow win(
-		fName
-	);
-	win.Run();
 
-	return 0;
+	bool batch = false;
+	SchedulerOptions options;
+	string metricsFile;
+	int metricsInterval = 0;
+	string traceFile = getenv("JT_TRACE") ? getenv("JT_TRACE") : "";
+	string recordFile, eventsFile;
+	size_t recordSet = 0;
+	int stride = 1;
+	double gate = -1;
+	bool replay = false;
+	string gridFile, resultsFile, applyVideo;
+	bool coordinate = false;
+	CoordinatorOptions coordinatorOptions;
+	string workerAddress;
+	bool serve = false;
+	ServerOptions serverOptions;
+	// Sent to a running server instead of tracking here
+	json clientRequest;
+	int clientPort = 0;
+	string liveAddress;
+	int mockPort = 0;
+	vector<TrackerJTType> replayTypes;
+	int firstOption = 2;
+
+	// The recording replaces the video argument
+	if (strcmp(argv[1], "--replay") == 0 && argc > 2)
+	{
+		replay = true;
+		fName = argv[2];
+		firstOption = 3;
+	}
+	else if (strcmp(argv[1], "--worker") == 0 && argc > 2)
+	{
+		workerAddress = argv[2];
+		firstOption = 3;
+	}
+	else if (strcmp(argv[1], "--serve") == 0)
+	{
+		serve = true;
+	}
+	else if (strcmp(argv[1], "--submit") == 0 && argc > 3)
+	{
+		clientPort = atoi(argv[2]);
+		clientRequest = { { "type", "submit" }, { "video", argv[3] } };
+		firstOption = 4;
+	}
+	else if ((strcmp(argv[1], "--status") == 0 || strcmp(argv[1], "--shutdown") == 0) && argc > 2)
+	{
+		clientPort = atoi(argv[2]);
+		clientRequest = { { "type", argv[1] + 2 } };
+		firstOption = 3;
+	}
+	else if (strcmp(argv[1], "--mock-device") == 0 && argc > 2)
+	{
+		mockPort = atoi(argv[2]);
+		firstOption = 3;
+	}
+	else if (strcmp(argv[1], "--cancel") == 0 && argc > 3)
+	{
+		clientPort = atoi(argv[2]);
+		clientRequest = { { "type", "cancel" }, { "job", atoi(argv[3]) } };
+		firstOption = 4;
+	}
+	else if (strcmp(argv[1], "--sweep") == 0 && argc > 3)
+	{
+		fName = argv[2];
+		gridFile = argv[3];
+		firstOption = 4;
+	}
+
+	for (int i = firstOption; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--batch") == 0)
+			batch = true;
+		else if (strcmp(argv[i], "--decoders") == 0 && i + 1 < argc)
+		{
+			options.maxDecoders = max(1, atoi(argv[++i]));
+			clientRequest["decoders"] = options.maxDecoders;
+		}
+		else if (strcmp(argv[i], "--memory") == 0 && i + 1 < argc)
+		{
+			options.memoryBudget = (size_t)max(1, atoi(argv[++i])) * 1024 * 1024;
+			clientRequest["memory"] = max(1, atoi(argv[i]));
+		}
+		else if (strcmp(argv[i], "--live") == 0 && i + 1 < argc)
+			liveAddress = argv[++i];
+		else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+			serverOptions.maxJobs = max(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--priority") == 0 && i + 1 < argc)
+			clientRequest["priority"] = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--project") == 0 && i + 1 < argc)
+		{
+			ifstream in(argv[++i]);
+			json project = json::parse(in, nullptr, false);
+			if (project.is_discarded())
+				cout << "Cannot read project " << argv[i] << endl;
+			else
+				clientRequest["project"] = project;
+		}
+		else if (strcmp(argv[i], "--stride") == 0 && i + 1 < argc)
+			stride = max(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--gate") == 0 && i + 1 < argc)
+			gate = max(0.0, atof(argv[++i]));
+		else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc)
+			metricsFile = argv[++i];
+		else if (strcmp(argv[i], "--metrics-interval") == 0 && i + 1 < argc)
+			metricsInterval = max(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+			traceFile = argv[++i];
+		else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+			recordFile = argv[++i];
+		else if (strcmp(argv[i], "--set") == 0 && i + 1 < argc)
+			recordSet = max(0, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--events") == 0 && i + 1 < argc)
+			eventsFile = argv[++i];
+		else if (strcmp(argv[i], "--coordinate") == 0)
+			coordinate = true;
+		else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc)
+			coordinatorOptions.port = max(0, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc)
+			coordinatorOptions.localWorkers = max(0, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--shard-length") == 0 && i + 1 < argc)
+			coordinatorOptions.shardLength = max(0, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--results") == 0 && i + 1 < argc)
+			resultsFile = argv[++i];
+		else if (strcmp(argv[i], "--apply") == 0 && i + 1 < argc)
+			applyVideo = argv[++i];
+		else if (strcmp(argv[i], "--tracker") == 0 && i + 1 < argc)
+		{
+			auto type = magic_enum::enum_cast<TrackerJTType>(argv[++i]);
+			if (type.has_value())
+				replayTypes.push_back(type.value());
+			else
+				cout << "Unknown tracker " << argv[i] << endl;
+		}
+	}
+
+	if (!traceFile.empty())
+		TRACER->Start();
+
+	// Samples go next to the final dump, one json object per line
+	if (!metricsFile.empty() && metricsInterval > 0)
+		METRICS->StartSampling(metricsFile + ".samples.jsonl", metricsInterval);
+
+	int ret = 0;
+
+	PositionStreamPtr live;
+	if (!liveAddress.empty())
+	{
+		live = make_shared<PositionStream>();
+		if (!live->Open(liveAddress))
+		{
+			cout << "Cannot send positions to " << liveAddress << endl;
+			live = nullptr;
+		}
+	}
+
+	if (mockPort > 0)
+	{
+		MockDevice device(mockPort);
+		ret = device.Run() ? 0 : 1;
+	}
+	else if (clientPort > 0)
+	{
+		if (clientRequest["type"] == "submit")
+		{
+			clientRequest["stride"] = stride;
+			clientRequest["gate"] = gate;
+		}
+
+		json reply;
+		if (!JobServer::Request(clientPort, clientRequest, reply))
+		{
+			cout << "No job server on port " << clientPort << endl;
+			ret = 1;
+		}
+		else
+		{
+			cout << reply.dump(2) << endl;
+			ret = reply.value("type", "") == "error" ? 1 : 0;
+		}
+	}
+	else if (serve)
+	{
+		serverOptions.port = coordinatorOptions.port;
+		serverOptions.scheduler = options;
+
+		JobServer server(serverOptions);
+		ret = server.Run() ? 0 : 1;
+	}
+	else if (replay)
+	{
+		TrackerReplay tracker(fName);
+		if (!tracker.IsOpen())
+		{
+			cout << "Cannot read recording " << fName << endl;
+			ret = 1;
+		}
+		else
+		{
+			ret = tracker.RunAll(replayTypes, eventsFile) ? 0 : 1;
+		}
+	}
+	else if (!workerAddress.empty())
+	{
+		ShardWorker worker(workerAddress);
+		ret = worker.Run() ? 0 : 1;
+	}
+	else if (coordinate)
+	{
+		coordinatorOptions.stride = stride;
+		coordinatorOptions.gate = gate;
+
+		ShardCoordinator coordinator(fName, coordinatorOptions);
+		ret = coordinator.Run(argv[0]) ? 0 : 1;
+	}
+	else if (!gridFile.empty())
+	{
+		TrackerSweep sweep(fName);
+		ifstream in(gridFile);
+		json grid = json::parse(in, nullptr, false);
+
+		if (!sweep.IsOpen())
+		{
+			cout << "Cannot read recording " << fName << endl;
+			ret = 1;
+		}
+		else if (grid.is_discarded())
+		{
+			cout << "Cannot read grid " << gridFile << endl;
+			ret = 1;
+		}
+		else if (!sweep.Run(grid))
+		{
+			ret = 1;
+		}
+		else
+		{
+			sweep.PrintResults();
+
+			if (!resultsFile.empty())
+				sweep.SaveResults(resultsFile);
+
+			if (!applyVideo.empty())
+			{
+				Project project(applyVideo);
+				if (sweep.Apply(project))
+					project.Save();
+				else
+					ret = 1;
+			}
+		}
+	}
+	else if (!recordFile.empty())
+	{
+		BatchTracker tracker(fName, options);
+		ret = tracker.RecordSet(recordSet, recordFile) ? 0 : 1;
+	}
+	else if (batch)
+	{
+		// Track every set without opening a window
+		BatchTracker tracker(fName, options);
+		tracker.SetStride(stride);
+		tracker.SetMotionGate(gate);
+		tracker.SetLiveOutput(live);
+		ret = tracker.Run() ? 0 : 1;
+	}
+	else
+	{
+		TrackingWindow win(
+			fName
+		);
+		win.liveOutput = live;
+		win.Run();
+	}
+
+	if (live)
+		live->PrintSummary();
+
+	METRICS->StopSampling();
+	if (!metricsFile.empty() && !METRICS->Dump(metricsFile))
+		cout << "Writing metrics to " << metricsFile << " failed" << endl;
+
+	TRACER->Stop();
+	if (!traceFile.empty() && !TRACER->Write(traceFile))
+		cout << "Writing trace to " << traceFile << " failed" << endl;
+
+	return ret;
 }
@@ -0,0 +1,130 @@
+#include "Bidirectional.h"
+#include "TrackingStatus.h"
+#include "Calculator.h"
+#include "Diagnostics/Trace.h"
+
+#include <map>
+#include <set>
+
+using namespace std;
+using namespace cv;
+
+TrackingSetPtr MakePassSet(TrackingSetPtr set, bool backward)
+{
+	TrackingSetPtr pass = make_shared<TrackingSet>(set->timeStart, set->anchorEnd);
+	pass->trackingMode = set->trackingMode;
+	pass->events = make_unique<EventList>();
+
+	for (auto& t : set->targets)
+		pass->targets.push_back(backward ? t.AtEnd() : t);
+
+	auto lock = TraceLock(set->events->mtx, "EventList::mtx");
+
+	vector<EventPtr> events;
+	set->events->GetEvents(0, 0, events);
+	for (auto& e : events)
+		if (e->type == EventType::TET_BADFRAME)
+			pass->events->AddEvent(make_shared<TrackingEvent>(*e));
+
+	return pass;
+}
+
+static map<pair<time_t, string>, EventPtr> States(EventList& list)
+{
+	map<pair<time_t, string>, EventPtr> out;
+
+	auto lock = TraceLock(list.mtx, "EventList::mtx");
+
+	vector<EventPtr> events;
+	list.GetEvents(0, 0, events);
+	for (auto& e : events)
+		if (e->type == EventType::TET_STATE)
+			out[{ e->time, e->targetGuid }] = e;
+
+	return out;
+}
+
+int MergePasses(TrackingSetPtr set, EventList& forward, EventList& backward)
+{
+	auto forwardStates = States(forward);
+	auto backwardStates = States(backward);
+
+	{
+		auto lock = TraceLock(set->events->mtx, "EventList::mtx");
+		set->events->ClearEvents([](EventPtr e) { return e->type == EventType::TET_BADFRAME; });
+	}
+
+	// No single tracker state produced the merged results
+	set->checkpoints->Reset(set->GetSetup());
+
+	double span = max<time_t>(1, set->anchorEnd - set->timeStart);
+	std::set<time_t> times;
+
+	for (auto& t : set->targets)
+	{
+		string guid = t.GetGuid();
+
+		std::set<time_t> targetTimes;
+		for (auto& kv : forwardStates)
+			if (kv.first.second == guid)
+				targetTimes.insert(kv.first.first);
+		for (auto& kv : backwardStates)
+			if (kv.first.second == guid)
+				targetTimes.insert(kv.first.first);
+
+		for (time_t time : targetTimes)
+		{
+			auto f = forwardStates.find({ time, guid });
+			auto b = backwardStates.find({ time, guid });
+
+			EventPtr fe = f != forwardStates.end() ? f->second : nullptr;
+			EventPtr be = b != backwardStates.end() ? b->second : nullptr;
+
+			TrackingStatusBase& base = fe ? fe->state : be->state;
+			TrackingStatus status(t, base.trackingType);
+			TrackingStatusBase& merged = status;
+
+			// Weight of the backward pass, each pass is trusted most near its own anchor
+			double alpha = fe ? 0 : 1;
+			if (fe && be)
+			{
+				TrackingStatusBase& fs = fe->state;
+				TrackingStatusBase& bs = be->state;
+				double weight = min(1.0, max(0.0, (time - set->timeStart) / span));
+
+				Point2f d = Point2f(fs.center) - Point2f(bs.center);
+				double tolerance = max(16.0, (fs.size + bs.size) / 4.0);
+
+				if (!fs.active)
+					alpha = 1;
+				else if (!bs.active)
+					alpha = 0;
+				else if (sqrt(d.dot(d)) > tolerance)
+					alpha = weight > 0.5 ? 1 : 0;
+				else
+					alpha = weight;
+			}
+
+			if (alpha <= 0)
+				merged = fe->state;
+			else if (alpha >= 1)
+				merged = be->state;
+			else
+				merged.Interpolate(fe->state, be->state, alpha);
+
+			merged.color = base.color;
+			status.SnapResult(set->events, time);
+			times.insert(time);
+		}
+	}
+
+	// Positions depend on the previous frames, run the calculator in order over the merged result
+	TrackingCalculator calculator;
+	for (time_t time : times)
+		calculator.Update(set, time);
+
+	if (times.size() > 0)
+		set->timeEnd = *times.rbegin();
+
+	return times.size();
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "TrackingSet.h"
+
+// Copy of the set for one pass of bidirectional tracking, with its own events and the bad frames of the set.
+// The backward pass starts from the end anchors and runs from anchorEnd back to timeStart.
+TrackingSetPtr MakePassSet(TrackingSetPtr set, bool backward);
+
+// Writes the merged result of both passes to the events of the set and runs the calculator over it.
+// Where the passes agree they are blended by their distance from their anchor, where they do not the
+// pass closer to its anchor wins. Returns the number of merged frames.
+int MergePasses(TrackingSetPtr set, EventList& forward, EventList& backward);
@@ -1,5 +1,6 @@
 #include "Calculator.h"
 #include "TrackingSet.h"
+#include "Diagnostics/Trace.h"
 
 #include <opencv2/imgproc.hpp>
 
@@ -11,6 +12,37 @@ TrackingCalculator::TrackingCalculator()
 
 }
 
+void TrackingCalculator::Serialize(json& j)
+{
+	j["male"]["x"] = malePoint.x;
+	j["male"]["y"] = malePoint.y;
+	j["female"]["x"] = femalePoint.x;
+	j["female"]["y"] = femalePoint.y;
+	j["scale"] = scale;
+	j["size_start"] = sizeStart;
+	j["last_position_update"] = lastPositionUpdate;
+	j["position"] = position;
+	j["locked_on"] = lockedOn;
+	j["up"] = up;
+}
+
+void TrackingCalculator::Unserialize(json& j)
+{
+	Reset();
+
+	if (!j.is_object())
+		return;
+
+	malePoint = Point(j["male"]["x"], j["male"]["y"]);
+	femalePoint = Point(j["female"]["x"], j["female"]["y"]);
+	scale = j["scale"];
+	sizeStart = j["size_start"];
+	lastPositionUpdate = j["last_position_update"];
+	position = j["position"];
+	lockedOn = j["locked_on"];
+	up = j["up"];
+}
+
 TrackingEvent TrackingCalculator::GetRange(EventListPtr& eventList, time_t at)
 {
 	EventPtr rangeEvent = eventList->GetEvent(at, EventType::TET_POSITION_RANGE, nullptr, true);
@@ -42,9 +74,9 @@ TrackingEvent TrackingCalculator::GetRange(EventListPtr& eventList, time_t at)
 	return e;
 }
 
-bool TrackingCalculator::Update(TrackingSetPtr set, time_t t)
+bool TrackingCalculator::Update(TrackingSetPtr set, time_t t, EventPtr* turn)
 {
-	lock_guard<mutex> lock(set->events->mtx);
+	auto lock = TraceLock(set->events->mtx, "EventList::mtx");
 	auto& events = set->events;
 
 	TrackingTarget* backgroundTarget = set->GetTarget(TARGET_TYPE::TYPE_BACKGROUND);
@@ -182,6 +214,9 @@ bool TrackingCalculator::Update(TrackingSetPtr set, time_t t)
 			e->size = distance;
 			e->position = position;
 			lastPositionUpdate = t;
+
+			if (turn)
+				*turn = e;
 		}
 		else if (d > 0 && !up)
 		{
@@ -191,6 +226,9 @@ bool TrackingCalculator::Update(TrackingSetPtr set, time_t t)
 			e->size = distance;
 			e->position = position;
 			lastPositionUpdate = t;
+
+			if (turn)
+				*turn = e;
 		}
 	//}
 
@@ -266,7 +304,7 @@ void TrackingCalculator::Draw(TrackingSetPtr set, Mat& frame, time_t t, bool liv
 	EventPtr distanceEvent = nullptr;
 
 	{
-		lock_guard<mutex> lock(set->events->mtx);
+		auto lock = TraceLock(set->events->mtx, "EventList::mtx");
 
 		distanceEvent = set->events->GetEvent(t, EventType::TET_POSITION_RANGE, nullptr, true);
 
@@ -11,7 +11,8 @@ public:
 	TrackingCalculator();
 
 	TrackingEvent GetRange(EventListPtr& eventList, time_t at);
-	bool Update(TrackingSetPtr set, time_t t);
+	// turn is set to the TET_POSITION event when the stroke turned on this frame
+	bool Update(TrackingSetPtr set, time_t t, EventPtr* turn = nullptr);
 	void UpdatePositions(EventListPtr& eventList);
 	void Draw(TrackingSetPtr set, cv::Mat& frame, time_t t, bool livePosition = true, bool drawState = false);
 	void Reset()
@@ -24,6 +25,13 @@ public:
 		position = 0;
 	}
 
+	// Position after the last Update, 0 to 1
+	float GetPosition() { return position; };
+
+	// State between frames, for resuming from a checkpoint
+	void Serialize(json& j);
+	void Unserialize(json& j);
+
 
 protected:
 	cv::Point malePoint;
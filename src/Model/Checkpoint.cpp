@@ -0,0 +1,158 @@
+#include "Checkpoint.h"
+
+#include <magic_enum.hpp>
+#include <algorithm>
+
+using namespace std;
+using namespace cv;
+
+// TrackerCheckpoint
+
+TrackerCheckpoint TrackerCheckpoint::Unserialize(json& j)
+{
+	TrackerCheckpoint c;
+	c.targetGuid = j["target"];
+
+	auto tracker = magic_enum::enum_cast<TrackerJTType>((string)j["tracker"]);
+	if (tracker.has_value())
+		c.tracker = tracker.value();
+
+	c.state = TrackingStatusBase::Unserialize(j["state"]);
+
+	if (j.contains("velocity"))
+		c.velocity = Point2f(j["velocity"]["x"], j["velocity"]["y"]);
+
+	if (j.contains("model"))
+		c.model = j["model"];
+
+	return c;
+}
+
+void TrackerCheckpoint::Serialize(json& j)
+{
+	j["target"] = targetGuid;
+	j["tracker"] = magic_enum::enum_name(tracker);
+	state.Serialize(j["state"]);
+	j["velocity"]["x"] = velocity.x;
+	j["velocity"]["y"] = velocity.y;
+
+	if (!model.is_null())
+		j["model"] = model;
+}
+
+// Checkpoint
+
+TrackerCheckpoint* Checkpoint::Find(const string& targetGuid, TrackerJTType tracker)
+{
+	auto it = find_if(trackers.begin(), trackers.end(), [&](TrackerCheckpoint& c) {
+		return c.targetGuid == targetGuid && c.tracker == tracker;
+	});
+
+	return it == trackers.end() ? nullptr : &(*it);
+}
+
+CheckpointPtr Checkpoint::Unserialize(json& j)
+{
+	auto c = make_shared<Checkpoint>();
+	c->time = j["time"];
+
+	for (auto& t : j["trackers"])
+		c->trackers.push_back(TrackerCheckpoint::Unserialize(t));
+
+	if (j.contains("calculator"))
+		c->calculator = j["calculator"];
+
+	return c;
+}
+
+void Checkpoint::Serialize(json& j)
+{
+	j["time"] = time;
+	j["trackers"] = json::array();
+	j["calculator"] = calculator;
+
+	for (auto& t : trackers)
+		t.Serialize(j["trackers"][j["trackers"].size()]);
+}
+
+// CheckpointList
+
+void CheckpointList::Add(CheckpointPtr c)
+{
+	lock_guard<mutex> lock(mtx);
+	checkpoints[c->time] = c;
+}
+
+CheckpointPtr CheckpointList::GetBefore(time_t time)
+{
+	lock_guard<mutex> lock(mtx);
+
+	auto it = checkpoints.upper_bound(time);
+	if (it == checkpoints.begin())
+		return nullptr;
+
+	return prev(it)->second;
+}
+
+void CheckpointList::ClearAfter(time_t time)
+{
+	lock_guard<mutex> lock(mtx);
+	checkpoints.erase(checkpoints.upper_bound(time), checkpoints.end());
+}
+
+void CheckpointList::Reset(json s)
+{
+	lock_guard<mutex> lock(mtx);
+	checkpoints.clear();
+	setup = s;
+}
+
+bool CheckpointList::Matches(json& s)
+{
+	lock_guard<mutex> lock(mtx);
+	return setup == s;
+}
+
+size_t CheckpointList::Size()
+{
+	lock_guard<mutex> lock(mtx);
+	return checkpoints.size();
+}
+
+vector<time_t> CheckpointList::Times()
+{
+	lock_guard<mutex> lock(mtx);
+
+	vector<time_t> times;
+	for (auto& kv : checkpoints)
+		times.push_back(kv.first);
+
+	return times;
+}
+
+CheckpointListPtr CheckpointList::Unserialize(json& j)
+{
+	CheckpointListPtr list = make_unique<CheckpointList>();
+
+	if (j.contains("setup"))
+		list->setup = j["setup"];
+
+	for (auto& c : j["list"])
+	{
+		CheckpointPtr checkpoint = Checkpoint::Unserialize(c);
+		list->checkpoints[checkpoint->time] = checkpoint;
+	}
+
+	return list;
+}
+
+void CheckpointList::Serialize(json& j)
+{
+	lock_guard<mutex> lock(mtx);
+
+	j["setup"] = setup;
+	j["list"] = json::array();
+
+	for (auto& kv : checkpoints)
+		kv.second->Serialize(j["list"][j["list"].size()]);
+}
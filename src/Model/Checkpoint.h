@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Model.h"
+#include "TrackingStatus.h"
+
+#include <opencv2/core.hpp>
+#include <json.hpp>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+using json = nlohmann::json;
+
+// State of one tracker after a frame, enough to start it again on that frame
+struct TrackerCheckpoint
+{
+	TrackerCheckpoint()
+		:state(TRACKING_TYPE::TYPE_NONE, TARGET_TYPE::TYPE_UNKNOWN)
+	{
+
+	}
+
+	static TrackerCheckpoint Unserialize(json& j);
+	void Serialize(json& j);
+
+	std::string targetGuid;
+	TrackerJTType tracker = TrackerJTType::TRACKER_TYPE_UNKNOWN;
+	TrackingStatusBase state;
+	// Per frame displacement up to the checkpoint, for refining strided segments
+	cv::Point2f velocity;
+	// Tracker internal state, see TrackerJT::SaveModel
+	json model;
+};
+
+struct Checkpoint
+{
+	TrackerCheckpoint* Find(const std::string& targetGuid, TrackerJTType tracker);
+
+	static std::shared_ptr<Checkpoint> Unserialize(json& j);
+	void Serialize(json& j);
+
+	time_t time = 0;
+	std::vector<TrackerCheckpoint> trackers;
+	// TrackingCalculator after the frame
+	json calculator;
+};
+
+typedef std::shared_ptr<Checkpoint> CheckpointPtr;
+
+class CheckpointList;
+typedef std::unique_ptr<CheckpointList> CheckpointListPtr;
+
+// Periodic tracker snapshots of a set, tracking resumes from the last one before a time instead of from timeStart
+class CheckpointList
+{
+public:
+	void Add(CheckpointPtr c);
+	// Last checkpoint at or before the time, nullptr without
+	CheckpointPtr GetBefore(time_t time);
+	// Tracking again from a checkpoint makes the later ones stale
+	void ClearAfter(time_t time);
+	// Drops every checkpoint, the next ones are taken with this setup
+	void Reset(json setup);
+	// Checkpoints only hold for the targets and mode they were taken with, see TrackingSet::GetSetup
+	bool Matches(json& setup);
+	size_t Size();
+	std::vector<time_t> Times();
+
+	static CheckpointListPtr Unserialize(json& j);
+	void Serialize(json& j);
+
+protected:
+	std::mutex mtx;
+	json setup;
+	std::map<time_t, CheckpointPtr> checkpoints;
+};
@@ -0,0 +1,63 @@
+#include "Model.h"
+#include "Main.h"
+
+using namespace cv;
+using namespace std;
+
+Scalar myColors[] = {
+	{197, 100, 195},
+	{90, 56, 200},
+	{67, 163, 255},
+	{143, 176, 59},
+	{206, 29, 255},
+	{133, 108, 252},
+	{166, 252, 153},
+	{120, 128, 21},
+	{93, 236, 178},
+	{196, 108, 43},
+	{74, 110, 255},
+	{20, 249, 29},
+	{208, 173, 162}
+};
+
+Scalar PickColor(int index)
+{
+	if (index > sizeof(myColors))
+		index = index % sizeof(myColors);
+
+	return myColors[index];
+}
+
+string TargetTypeToString(TARGET_TYPE t)
+{
+	switch (t) {
+	case TYPE_MALE:
+		return "Male";
+	case TYPE_FEMALE:
+		return "Female";
+	case TYPE_BACKGROUND:
+		return "Background";
+	default:
+		return "Unknown";
+	}
+}
+
+string TrackingModeToString(TrackingMode m)
+{
+	switch (m) {
+	case TM_DIAGONAL:
+		return "Diagonal";
+	case TM_HORIZONTAL:
+		return "Horizontal";
+	case TM_VERTICAL:
+		return "Vertical";
+	case TM_DIAGONAL_SINGLE:
+		return "X/Y move";
+	case TM_HORIZONTAL_SINGLE:
+		return "X move";
+	case TM_VERTICAL_SINGLE:
+		return "Y move";
+	default:
+		return "None";
+	}
+}
@@ -48,7 +48,9 @@ enum TrackerJTType
 	CPU_RECT_MEDIAN_FLOW,
 	CPU_RECT_CSRT,
 	CPU_RECT_MIL,
-	CPU_RECT_KCF
+	CPU_RECT_KCF,
+
+	ENSEMBLE_FUSED
 };
 
 struct PointState
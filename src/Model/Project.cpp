@@ -50,11 +50,17 @@ string Project::GetConfigPath()
 		projectsPath = projectsPath.parent_path();
 
 	filesystem::path videoPath = video;
-	string configFile = projectsPath.string() + "\\" + videoPath.filename().replace_extension().string() + ".json";
+	string configFile = projectsPath.string() + PATH_SEP + videoPath.filename().replace_extension().string() + ".json";
 
 	return configFile;
 }
 
+string Project::GetFunscriptPath()
+{
+	filesystem::path configPath = GetConfigPath();
+	return configPath.replace_extension(".funscript").string();
+}
+
 void Project::Load()
 {
 	string file = GetConfigPath();
@@ -97,21 +103,46 @@ void Project::Save(json& j)
 {
 	j["fps_max"] = maxFPS;
 	j["sets"] = json::array();
-	j["actions"] = json::array();
 
 	for (auto s : sets)
 	{
 		json& set = j["sets"][j["sets"].size()];
 		s->Serialize(set);
+	}
+
+	GetActions(j["actions"]);
+}
+
+void Project::SaveFunscript()
+{
+	string file = GetFunscriptPath();
+	ofstream o(file);
+	if (o.fail())
+		return;
+
+	json j;
+	j["version"] = "1.0";
+	j["inverted"] = false;
+	j["range"] = 100;
+	GetActions(j["actions"]);
+
+	o << j << endl;
+}
 
+void Project::GetActions(json& actions)
+{
+	actions = json::array();
+
+	for (auto s : sets)
+	{
 		vector<EventPtr> events;
 		s->events->GetEvents(s->timeStart, s->timeEnd, events);
-		
+
 		for (auto& e : events)
 		{
 			if (e->type == EventType::TET_POSITION)
 			{
-				json& a = j["actions"][j["actions"].size()];
+				json& a = actions[actions.size()];
 				a["at"] = e->time;
 				a["pos"] = (int)(e->position * 100);
 			}
@@ -12,11 +12,14 @@ public:
 	~Project();
 
 	std::string GetConfigPath();
+	std::string GetFunscriptPath();
 
 	void Load();
 	void Load(json j);
 	void Save();
 	void Save(json& j);
+	void SaveFunscript();
+	void GetActions(json& actions);
 
 	std::vector<std::shared_ptr<TrackingSet>> sets;
 	int maxFPS = 120;
@@ -1,6 +1,12 @@
 #include "TrackingRunner.h"
-#include "Gui/TrackingWindow.h"
 #include "Tracking/FrameCache.h"
+#include "Diagnostics/Metrics.h"
+#include "Diagnostics/Trace.h"
+
+#ifdef WITH_CUDA
+#include "Gui/TrackingWindow.h"
+#include <opencv2/cudaarithm.hpp>
+#endif
 
 #include <opencv2/imgproc.hpp>
 #include <magic_enum.hpp>
@@ -17,80 +23,445 @@ using namespace std;
 using namespace cv;
 using namespace chrono;
 
+// Decoded frames are in device memory with cuda and in host memory without
+
+static DecodedFrame Grey(DecodedFrame frame)
+{
+#ifdef WITH_CUDA
+    return FRAME_CACHE->GpuVariant(frame, GPU_GREY);
+#else
+    return FRAME_CACHE->CpuVariant(frame, GPU_GREY);
+#endif
+}
+
+#ifndef WITH_CUDA
+static HostFrame ToHost(DecodedFrame frame, FrameVariant v)
+{
+    HostFrame host = { { GPU_RGBA, frame } };
+    if (v != GPU_RGBA)
+        host[FrameCache::LocalVariant(v)] = FRAME_CACHE->CpuVariant(frame, v);
+
+    return host;
+}
+#endif
+
 // TrackerBinding
 
 TrackerBinding::TrackerBinding(TrackingSetPtr set, TrackingTarget* target, TrackerJTStruct& trackerStruct, bool saveResults)
-    :set(set), target(target), trackerStruct(trackerStruct), saveResults(saveResults)
+    :set(set), target(target), trackerStruct(trackerStruct), saveResults(saveResults), strand(WORKER_POOL)
 {
     state.reset(target->InitTracking(trackerStruct.trackingType));
     tracker.reset(trackerStruct.Create(*target, *state));
+    updateLatency = &METRICS->Histogram(string("track.") + tracker->GetName());
+    strand.SetActive(false);
 };
 
 TrackerBinding::~TrackerBinding()
 {
+    strand.Clear();
     Join();
 }
 
+void TrackerBinding::Init(DecodedFrame frame)
+{
+    InitTracker(frame);
+    AddSample(frame);
+
+    if (gateThreshold > 0)
+        gateGrey = Grey(frame);
+
+    prevFrame = frame;
+    prevCenter = state->center;
+    prevVelocity = Point2f();
+}
+
+void TrackerBinding::Reinit(TrackingStatus& from, DecodedFrame frame)
+{
+    // The status keeps a reference to its target, only the tracking result is copied
+    static_cast<TrackingStatusBase&>(*state) = from;
+
+    tracker.reset(trackerStruct.Create(*target, *state));
+    if (qosFps > 0)
+        tracker->EnableQos(qosFps);
+
+    InitTracker(frame);
+}
+
+bool TrackerBinding::CanResume(Checkpoint& c)
+{
+    return c.Find(target->GetGuid(), trackerStruct.type) != nullptr;
+}
+
+void TrackerBinding::Resume(Checkpoint& c, DecodedFrame frame)
+{
+    TrackerCheckpoint* t = c.Find(target->GetGuid(), trackerStruct.type);
+    if (!t)
+        throw "No checkpoint for the tracker";
+
+    Scalar color = state->color;
+    static_cast<TrackingStatusBase&>(*state) = t->state;
+    state->color = color;
+
+    tracker->LoadModel(t->model);
+    Init(frame);
+
+    prevVelocity = t->velocity;
+}
+
+bool TrackerBinding::ApplyAnchor(time_t time, DecodedFrame frame)
+{
+    static atomic<int64_t>& anchors = METRICS->Counter("anchors.applied");
+
+    auto it = target->anchors.find(time);
+    if (it == target->anchors.end())
+        return false;
+
+    TrackingTarget moved = target->MovedTo(it->second);
+    unique_ptr<TrackingStatus> initial(moved.InitTracking(trackerStruct.trackingType));
+    initial->color = state->color;
+
+    Reinit(*initial, frame);
+    AddSample(frame);
+
+    prevCenter = state->center;
+    prevVelocity = Point2f();
+    lostFrames = 0;
+    anchors++;
+
+    return true;
+}
+
+void TrackerBinding::SetQos(double targetFps)
+{
+    qosFps = targetFps;
+    if (qosFps > 0)
+        tracker->EnableQos(qosFps);
+}
+
 void TrackerBinding::Start()
 {
-    running = true;
-    this->myThread = thread(&TrackerBinding::RunThread, this);
+    strand.SetActive(true);
 }
 
 void TrackerBinding::Join()
 {
-    if(running)
-    {
-        running = false;
-        myThread.join();
-    }
+    strand.SetActive(false);
+    strand.WaitIdle();
+}
+
+void TrackerBinding::Push(FrameWorkPtr fw, ThreadWorkPtr w)
+{
+    strand.Post([this, fw, w]() { RunWork(fw, w); });
 }
 
-void TrackerBinding::RunThread()
+void TrackerBinding::RunWork(FrameWorkPtr fw, ThreadWorkPtr w)
 {
-    while (running)
+    static atomic<int64_t>& failures = METRICS->Counter("tracker.failures");
+    static atomic<int64_t>& refinements = METRICS->Counter("stride.refinements");
+    static atomic<int64_t>& gatedFrames = METRICS->Counter("gate.skipped");
+
+    TraceScope span(tracker->GetName(), "tracker");
+
+    unique_ptr<TrackingStatus> before;
+    if (!fw->skipped.empty())
+        before = make_unique<TrackingStatus>(*state);
+
+    auto now = high_resolution_clock::now();
+    // A corrected frame replaces whatever the tracker would have found
+    bool anchored = ApplyAnchor(w->frameTime, w->frame);
+    // Duplicated and still frames give the same result, the previous one is reused
+    bool gated = !anchored && Unchanged(w->frame);
+    bool ok = anchored || gated ? state->active : UpdateTracker(w->frame);
+    int frames = fw->skipped.size() + 1;
+
+    if (gated)
+        gatedFrames++;
+
+    // Nothing to refine once the target was already lost before the segment
+    if (!anchored && !gated && before && before->active && NeedsRefine(*before, ok, frames))
     {
-        workMtx.lock();
-        if (work.size() == 0)
+        // Go back to the last tracked frame and track the segment densely
+        TraceScope refineSpan("refine");
+        refinements++;
+
+        Reinit(*before, prevFrame);
+        for (auto& s : fw->skipped)
         {
-            workMtx.unlock();
-            this_thread::sleep_for(50us);
-            continue;
+            UpdateTracker(s.second);
+            if (saveResults)
+                w->refined.emplace_back(s.first, make_unique<TrackingStatus>(*state));
         }
 
-        ThreadWorkPtr w = work.back();
-        work.pop_back();
-        workMtx.unlock();
+        ok = UpdateTracker(w->frame);
+        w->refine = true;
+    }
 
-        auto now = high_resolution_clock::now();
-        if (!tracker->update(w->frame))
-            w->err = true;
+    bool redetected = false;
+    if (ok)
+    {
+        lostFrames = 0;
+        if (++sampleFrames >= sampleInterval)
+        {
+            AddSample(w->frame);
+            sampleFrames = 0;
+        }
+    }
+    else if (lostFrames++ % redetectInterval == 0)
+    {
+        ok = redetected = Redetect(w->frame);
+    }
 
-        w->durationMs = duration_cast<chrono::milliseconds>(high_resolution_clock::now() - now).count();
-        lastUpdateMs = w->durationMs;
+    if (!ok)
+    {
+        w->err = true;
+        failures++;
+    }
 
-        if (saveResults)
-            state->SnapResult(set->events, w->frameTime);
+    if (redetected || anchored)
+    {
+        prevVelocity = Point2f();
+    }
+    else
+    {
+        Point2f moved = Point2f(state->center) - Point2f(before ? before->center : prevCenter);
+        prevVelocity = moved / (float)frames;
+    }
+
+    prevCenter = state->center;
+    prevFrame = w->frame;
+
+    if (!gated && gateThreshold > 0)
+        gateGrey = Grey(w->frame);
+
+    if (saveResults && fw->checkpoint)
+    {
+        w->checkpoint = make_unique<TrackerCheckpoint>();
+        w->checkpoint->targetGuid = target->GetGuid();
+        w->checkpoint->tracker = trackerStruct.type;
+        w->checkpoint->state = *state;
+        w->checkpoint->velocity = prevVelocity;
+        tracker->SaveModel(w->checkpoint->model);
+    }
+
+    w->serviceMs = duration<double, milli>(high_resolution_clock::now() - now).count();
+    updateLatency->Record(w->serviceMs);
+    w->durationMs = (int)w->serviceMs;
+    lastUpdateMs = w->durationMs;
+
+    if (saveResults || fw->preview)
+        w->result = make_unique<TrackingStatus>(*state);
+
+    if (fw->preview)
+        w->label = Label();
+
+    if (saveResults && !w->refine)
+        w->previous = move(before);
+
+    w->done = true;
+    fw->Finish();
+}
+
+void TrackerBinding::InitTracker(DecodedFrame frame)
+{
+#ifdef WITH_CUDA
+    tracker->init(frame);
+#else
+    HostFrame host = ToHost(frame, tracker->GetFrameType());
+    tracker->init(host);
+#endif
+}
+
+bool TrackerBinding::UpdateTracker(DecodedFrame frame)
+{
+#ifdef WITH_CUDA
+    return tracker->update(frame);
+#else
+    HostFrame host = ToHost(frame, tracker->GetFrameType());
+    return tracker->update(host);
+#endif
+}
+
+string TrackerBinding::Label()
+{
+    string label = tracker->GetName();
+    if (tracker->GetScale() != 1)
+        label += format(" @%d%%", (int)(tracker->GetScale() * 100));
+
+    return label;
+}
+
+Rect TrackerBinding::StatusBox(TrackingStatusBase& s)
+{
+    if (s.trackingType == TRACKING_TYPE::TYPE_RECT)
+        return s.rect;
+
+    vector<Point> active;
+    for (auto& p : s.points)
+        if (p.active)
+            active.push_back(p.point);
+
+    return active.empty() ? s.rect : boundingRect(active);
+}
+
+bool TrackerBinding::Unchanged(DecodedFrame frame)
+{
+    if (gateThreshold <= 0 || gateGrey.empty() || !state->active)
+        return false;
 
-        w->done = true;
+    // The area the target can reach in a frame, limited to its range
+    Rect box = StatusBox(*state);
+    Rect area(box.x - box.width, box.y - box.height, box.width * 3, box.height * 3);
+    if (!target->range.empty())
+        area &= target->range;
+
+    area &= Rect(Point(), gateGrey.size());
+    if (area.empty() || frame.size() != gateGrey.size())
+        return false;
+
+    TRACE_SCOPE("motion gate");
+
+    DecodedFrame grey = Grey(frame);
+#ifdef WITH_CUDA
+    double difference = cuda::norm(grey(area), gateGrey(area), NORM_L1) / area.area();
+#else
+    double difference = norm(grey(area), gateGrey(area), NORM_L1) / area.area();
+#endif
+
+    return difference < gateThreshold;
+}
+
+void TrackerBinding::AddSample(DecodedFrame frame)
+{
+    Rect box = StatusBox(*state) & Rect(Point(), frame.size());
+    if (box.width < 2 || box.height < 2)
+        return;
+
+    // Only the target leaves the gpu
+    Mat patch;
+#ifdef WITH_CUDA
+    Grey(frame)(box).download(patch);
+#else
+    Grey(frame)(box).copyTo(patch);
+#endif
+    redetector.AddSample(patch);
+}
+
+bool TrackerBinding::Redetect(DecodedFrame frame)
+{
+    static atomic<int64_t>& attempts = METRICS->Counter("redetect.attempts");
+    static atomic<int64_t>& recovered = METRICS->Counter("redetect.recovered");
+
+    if (redetector.Empty())
+        return false;
+
+    TraceScope span("redetect");
+    attempts++;
+
+    Rect found;
+    double score;
+    if (!redetector.Detect(FRAME_CACHE->CpuVariant(frame, LOCAL_GREY), target->range, found, score))
+        return false;
+
+    // Start over from the initial layout of the target, placed on the match
+    unique_ptr<TrackingStatus> initial(target->InitTracking(trackerStruct.trackingType));
+    Rect initialBox = StatusBox(*initial);
+
+    TrackingStatus status(*state);
+    status.active = true;
+    status.rect = found;
+    status.center = (found.tl() + found.br()) / 2;
+    status.points = initial->points;
+
+    if (initialBox.width > 0 && initialBox.height > 0)
+    {
+        double sx = (double)found.width / initialBox.width;
+        double sy = (double)found.height / initialBox.height;
+
+        for (auto& p : status.points)
+            p.point = found.tl() + Point(cvRound((p.point.x - initialBox.x) * sx), cvRound((p.point.y - initialBox.y) * sy));
     }
+
+    Reinit(status, frame);
+    if (!state->active)
+        return false;
+
+    recovered++;
+    return true;
+}
+
+bool TrackerBinding::NeedsRefine(TrackingStatus& before, bool ok, int frames)
+{
+    if (!ok || !state->active)
+        return true;
+
+    Point2f velocity = (Point2f(state->center) - Point2f(before.center)) / (float)frames;
+    Point2f change = velocity - prevVelocity;
+    if (sqrt(change.dot(change)) > refineAcceleration)
+        return true;
+
+    // Points lost on the way are a sign of fast motion or occlusion the tracker only partly followed
+    auto countActive = [](TrackingStatus& s) {
+        return count_if(s.points.begin(), s.points.end(), [](PointState& p) { return p.active; });
+    };
+
+    int activeBefore = countActive(before);
+    return activeBefore > 0 && countActive(*state) * 4 < activeBefore * 3;
 }
 
 // TrackingRunner
-TrackingRunner::TrackingRunner(TrackingWindow* w, TrackingSetPtr set, TrackingTarget* target, bool saveResults, bool allTrackerTypes, bool videoThread)
-    :w(w), set(set), target(target), saveResults(saveResults), allTrackerTypes(allTrackerTypes)
+#ifdef WITH_CUDA
+TrackingRunner::TrackingRunner(TrackingWindow* w, TrackingSetPtr set, TrackingTarget* target, bool saveResults, bool allTrackerTypes)
+    :w(w), set(set), target(target), saveResults(saveResults), allTrackerTypes(allTrackerTypes),
+    decoded(decodeAhead), tracking(1), snapped(decodeAhead)
+{
+    videoReader = VideoReader::open(w->project.video);
+}
+#endif
+
+TrackingRunner::TrackingRunner(string video, TrackingSetPtr set, TrackingTarget* target, bool saveResults, bool allTrackerTypes, bool reverse)
+    :TrackingRunner(VideoReader::open(video), set, target, saveResults, allTrackerTypes, reverse)
+{
+
+}
+
+TrackingRunner::TrackingRunner(Ptr<VideoReader> reader, TrackingSetPtr set, TrackingTarget* target, bool saveResults, bool allTrackerTypes, bool reverse)
+    :w(nullptr), set(set), target(target), saveResults(saveResults), allTrackerTypes(allTrackerTypes), reverse(reverse),
+    decoded(decodeAhead), tracking(1), snapped(decodeAhead)
 {
-    if (videoThread)
-        videoReader = VideoReader::create(w->project.video);
+    videoReader = reverse ? VideoReader::createReverse(reader) : reader;
 }
 
 TrackingRunner::~TrackingRunner()
 {
     SetRunning(false);
+    StopPipeline();
+    ReserveCache(0);
+}
+
+void TrackingRunner::SetMemoryBudget(size_t bytes)
+{
+    controller.SetMemoryBudget(bytes);
+}
+
+void TrackingRunner::ReserveCache(int records)
+{
+    FRAME_CACHE->Reserve(records - cacheReserved);
+    cacheReserved = records;
+}
+
+void TrackingRunner::UpdateDepth()
+{
+    int depth = controller.Depth();
+
+    // The snapshot stage holds one frame on top of the queue
+    tracking.SetCapacity(max(1, depth - 1));
+    ReserveCache((depth + decodeAhead * 2) * max(1, (int)variants.size()));
 }
 
 RunnerState TrackingRunner::GetState(bool resetFramesRdy) 
 {
+    lock_guard<mutex> lock(stateMtx);
+
     RunnerState ret = state;
     if (resetFramesRdy)
         state.framesRdy = 0;
@@ -98,147 +469,543 @@ RunnerState TrackingRunner::GetState(bool resetFramesRdy)
     return ret;
 }
 
-void TrackingRunner::PushWork(int frames)
+bool TrackingRunner::IsBadFrame(time_t time)
 {
-    while (workMap.size() < maxWork && frames > 0)
+    auto lock = TraceLock(set->events->mtx, "EventList::mtx");
+    return set->events->GetEvent(time, EventType::TET_BADFRAME) != nullptr;
+}
+
+FrameWorkPtr TrackingRunner::AddDecoded(DecodedFrame frame, time_t time)
+{
+    // Anchored frames are always tracked, a skipped one would be interpolated over
+    if (stride > 1 && denseFrames == 0 && ++strideCount < stride && !set->HasAnchor(time))
+    {
+        pendingSkipped.emplace_back(time, frame);
+        return nullptr;
+    }
+
+    if (denseFrames > 0)
+        denseFrames--;
+
+    return MakeWork(frame, time);
+}
+
+FrameWorkPtr TrackingRunner::FlushSkipped()
+{
+    if (pendingSkipped.empty())
+        return nullptr;
+
+    auto last = pendingSkipped.back();
+    pendingSkipped.pop_back();
+
+    return MakeWork(last.second, last.first);
+}
+
+FrameWorkPtr TrackingRunner::MakeWork(DecodedFrame frame, time_t time)
+{
+    static atomic<int64_t>& skippedFrames = METRICS->Counter("frames.skipped");
+
+    auto fw = make_shared<FrameWork>(frame, time);
+    fw->skipped.swap(pendingSkipped);
+    fw->previousTime = lastTrackedTime;
+
+    skippedFrames += fw->skipped.size();
+    strideCount = 0;
+    lastTrackedTime = time;
+
+    return fw;
+}
+
+bool TrackingRunner::PushDecoded(FrameWorkPtr fw)
+{
+    {
+        // A single step is one tracked frame, skipped frames are free
+        lock_guard<mutex> lock(decodeMtx);
+        if (!running && decodeCredits > 0)
+            decodeCredits--;
+    }
+
+    inFlight++;
+    return decoded.Push(fw);
+}
+
+CheckpointPtr TrackingRunner::FindResume()
+{
+    // Reverse passes run on a copy of the set and keep no checkpoints
+    if (!saveResults || reverse || resumeTime <= set->timeStart)
+        return nullptr;
+
+    json setup = set->GetSetup();
+    if (!set->checkpoints->Matches(setup))
+        return nullptr;
+
+    CheckpointPtr c = set->checkpoints->GetBefore(resumeTime);
+    if (!c || c->time <= set->timeStart)
+        return nullptr;
+
+    for (auto& b : bindings)
+        if (!b->CanResume(*c))
+            return nullptr;
+
+    return c;
+}
+
+void TrackingRunner::AddCheckpoint(FrameWorkPtr fw)
+{
+    static atomic<int64_t>& checkpoints = METRICS->Counter("checkpoints.taken");
+
+    auto c = make_shared<Checkpoint>();
+    c->time = fw->time;
+    calculator.Serialize(c->calculator);
+
+    for (auto& w : fw->work)
+    {
+        if (!w->checkpoint)
+            return;
+
+        c->trackers.push_back(move(*w->checkpoint));
+    }
+
+    set->checkpoints->Add(c);
+    checkpoints++;
+}
+
+void TrackingRunner::PopWork()
+{
+    time_t time;
+    while (completed.TryPop(time))
+        ;
+}
+
+void TrackingRunner::PublishPreview(DecodedFrame frame, time_t time, vector<TrackingStatusBase> states, vector<string> labels)
+{
+    static atomic<int64_t>& previewFrames = METRICS->Counter("preview.published");
+
+    PreviewFrame p;
+    p.frame = frame;
+    p.time = time;
+    p.states = move(states);
+    p.labels = move(labels);
+
+    previews.Publish(move(p));
+    previewFrames++;
+}
+
+bool TrackingRunner::TakePreview()
+{
+    if (!previews.Take(shown))
+        return false;
+
+#ifdef WITH_CUDA
+    if (w)
+        w->ShowFrame(shown.frame, shown.time);
+#endif
+
+    return true;
+}
+
+bool TrackingRunner::WaitFrame(chrono::milliseconds timeout)
+{
+    time_t time;
+    return completed.PopFor(time, timeout);
+}
+
+void TrackingRunner::SetDecodeDone()
+{
+    lock_guard<mutex> lock(stateMtx);
+    decodeDone = true;
+
+    if (inFlight == 0)
+        state.finished = true;
+}
+
+// Stage graph
+
+void TrackingRunner::StartPipeline()
+{
+    stopping = false;
+    decoded.Reopen();
+    tracking.Reopen();
+    snapped.Reopen();
+
+    if (videoReader)
+        decodeStage.Start([this]() { DecodeStage(); });
+
+    prepareStage.Start([this]() { PrepareStage(); });
+    snapshotStage.Start([this]() { SnapshotStage(); });
+    calculateStage.Start([this]() { CalculateStage(); });
+}
+
+void TrackingRunner::StopPipeline()
+{
+    {
+        lock_guard<mutex> lock(decodeMtx);
+        stopping = true;
+        decodeCredits = 0;
+    }
+    decodeCv.notify_all();
+
+    decoded.Close();
+    tracking.Close();
+    snapped.Close();
+
+    decodeStage.Join();
+    prepareStage.Join();
+    snapshotStage.Join();
+    calculateStage.Join();
+
+    decoded.Clear();
+    tracking.Clear();
+    snapped.Clear();
+    completed.Clear();
+    inFlight = 0;
+}
+
+void TrackingRunner::DecodeStage()
+{
+    static atomic<int64_t>& badFrames = METRICS->Counter("frames.bad");
+
+    while (true)
     {
-        cuda::GpuMat gpuFrame;
-        time_t time;
-        if (videoReader)
         {
-            gpuFrame = videoReader->NextFrame();
+            unique_lock<mutex> lock(decodeMtx);
+            decodeCv.wait(lock, [this]() { return stopping || running || decodeCredits > 0; });
+
+            if (stopping)
+                return;
+        }
+
+        DecodedFrame frame;
+        time_t time;
+
+        TRACE_SCOPE("decode frame");
+        auto now = high_resolution_clock::now();
+
+        try {
+            frame = videoReader->NextDecoded();
             time = videoReader->GetPosition();
         }
-        else
-        {
-            gpuFrame = w->ReadCleanFrame();
-            time = w->GetCurrentPosition();
+        catch (...) {
+            // End of the video
+            FrameWorkPtr last = FlushSkipped();
+            if (last)
+                PushDecoded(last);
+
+            SetDecodeDone();
+            return;
         }
 
-        if (set->events->GetEvent(time, EventType::TET_BADFRAME))
-            continue;
+        controller.Record(STAGE_DECODE, duration<double, milli>(high_resolution_clock::now() - now).count());
 
-        frames--;
+        bool pastLimit = reverse ? time < timeLimit : timeLimit != 0 && time >= timeLimit;
+        if (pastLimit)
+        {
+            FrameWorkPtr last = FlushSkipped();
+            if (last)
+                PushDecoded(last);
 
-        assert(workMap.count(time) == 0);
+            SetDecodeDone();
+            return;
+        }
 
-        FrameWork fw;
-        fw.time = time;
-        fw.timeStart = steady_clock::now();
-        
-        for (auto& b : bindings)
+        if (IsBadFrame(time))
         {
-            lock_guard<mutex> lock(b->workMtx);
-            ThreadWorkPtr w = make_shared<ThreadWork>(gpuFrame, time);
-            b->work.push_front(w);
-            fw.work.push_back(w);
+            badFrames++;
+            continue;
         }
 
-        workMap.insert(pair<time_t, FrameWork>(time, fw));
+        FrameWorkPtr fw = AddDecoded(frame, time);
+        if (fw && !PushDecoded(fw))
+            return;
     }
 }
 
-void TrackingRunner::PopWork()
+void TrackingRunner::PrepareStage()
 {
-    for (auto it = workMap.begin(), next_it = it; it != workMap.end(); it = next_it)
+    FrameWorkPtr fw;
+    while (decoded.Pop(fw))
     {
-        ++next_it;
-
-        bool isDone = true;
+        TRACE_SCOPE("prepare");
+        auto now = high_resolution_clock::now();
 
-        for (auto w : it->second.work)
-            if (!w->done)
+        // Convert once here instead of inside whichever tracker asks first
+        for (auto v : variants)
+        {
+#ifdef WITH_CUDA
+            if (!FRAME_CACHE->IsCpu(v))
             {
-                isDone = false;
-                break;
+                FRAME_CACHE->GpuVariant(fw->frame, v);
+                continue;
             }
+#endif
+            FRAME_CACHE->CpuVariant(fw->frame, v);
+        }
 
-        if (!isDone)
-            continue;
+        controller.Record(STAGE_PREPARE, duration<double, milli>(high_resolution_clock::now() - now).count());
 
-        state.framesRdy++;
-        state.lastTime = max(state.lastTime, it->first);
-        state.lastWorkMs = duration_cast<chrono::milliseconds>(high_resolution_clock::now() - it->second.timeStart).count();
-        
-        workMap.erase(it);
+        if (recorder)
+        {
+            // Recordings stay dense so replays see every frame
+            for (auto& s : fw->skipped)
+                recorder->Write(s.first, s.second, variants);
 
-        if (saveResults)
+            recorder->Write(fw->time, fw->frame, variants);
+        }
+
+        // The window redraws at its own rate, single steps are always shown
+        auto previewNow = steady_clock::now();
+        if (w && (!running || previewNow - lastPreview >= duration<double>(1.0 / previewFps)))
         {
-            set->timeEnd = state.lastTime;
-            calculator.Update(set, state.lastTime);
+            fw->preview = true;
+            lastPreview = previewNow;
         }
+
+        // Only tracked frames have a tracker state to keep
+        if (saveResults && !reverse && fw->time >= nextCheckpoint)
+        {
+            fw->checkpoint = true;
+            nextCheckpoint = fw->time + checkpointInterval;
+        }
+
+        fw->timeStart = steady_clock::now();
+        fw->remaining = bindings.size();
+
+        for (auto& b : bindings)
+            fw->work.push_back(make_shared<ThreadWork>(fw->frame, fw->time));
+
+        // Blocks while too many frames are in flight
+        if (!tracking.Push(fw))
+            return;
+
+        for (int i = 0; i < bindings.size(); i++)
+            bindings.at(i)->Push(fw, fw->work.at(i));
     }
 }
 
-void TrackingRunner::Update(bool blocking)
+void TrackingRunner::SnapshotStage()
 {
-    if (!initialized && !Setup())
-        throw "Tracking setup failed";
+    static LatencyHistogram& snapshotLatency = METRICS->Histogram("snapshot");
 
+    FrameWorkPtr fw;
+    while (tracking.Pop(fw))
+    {
+        {
+            TRACE_SCOPE("wait tracked");
+            while (fw->trackedFuture.wait_for(10ms) != future_status::ready)
+            {
+                if (stopping)
+                    return;
+            }
+        }
 
-    /*
-    cuda::GpuMat frame = w->ReadCleanFrame();
-    time_t time = w->GetCurrentPosition();
-    FRAME_CACHE->CpuVariant(frame, FrameVariant::LOCAL_GREY);
-    FRAME_CACHE->CpuVariant(frame, FrameVariant::LOCAL_RGB);
+        TRACE_SCOPE("snapshot");
 
-    for (auto& b : bindings)
+        // Bindings run in parallel, the frame costs as much as its slowest tracker unless the pool is oversubscribed
+        double trackMs = 0, trackSumMs = 0;
+        for (auto& w : fw->work)
+        {
+            trackMs = max(trackMs, w->serviceMs);
+            trackSumMs += w->serviceMs;
+        }
+        controller.Record(STAGE_TRACK, max(trackMs, trackSumMs / WORKER_POOL->Size()));
+
+        auto now = high_resolution_clock::now();
+
+        bool refined = false;
+
+        for (auto& w : fw->work)
+        {
+            refined |= w->refine;
+
+            if (!saveResults || !w->result)
+                continue;
+
+            if (w->refine)
+            {
+                for (auto& r : w->refined)
+                    r.second->SnapResult(set->events, r.first);
+            }
+            else if (w->previous)
+            {
+                // Linear in time between the two tracked frames, the refinement covers the segments where that does not hold
+                TrackingStatus between(*w->result);
+                double span = fw->time != fw->previousTime ? (double)(fw->time - fw->previousTime) : 1;
+
+                for (auto& s : fw->skipped)
+                {
+                    between.Interpolate(*w->previous, *w->result, (s.first - fw->previousTime) / span);
+                    between.SnapResult(set->events, s.first);
+                }
+            }
+
+            w->result->SnapResult(set->events, fw->time);
+        }
+
+        // Stay dense for a while after a sharp change, the next segments are likely just as busy
+        if (refined)
+            denseFrames = stride * denseStrides;
+
+        double snapshotMs = duration<double, milli>(high_resolution_clock::now() - now).count();
+        controller.Record(STAGE_SNAPSHOT, snapshotMs);
+        snapshotLatency.Record(snapshotMs);
+
+        if (!snapped.Push(fw))
+            return;
+    }
+}
+
+void TrackingRunner::CalculateStage()
+{
+    static LatencyHistogram& calculateLatency = METRICS->Histogram("calculate");
+    static LatencyHistogram& frameLatency = METRICS->Histogram("frame");
+    static atomic<int64_t>& frames = METRICS->Counter("frames.tracked");
+
+    FrameWorkPtr fw;
+    while (snapped.Pop(fw))
     {
+        TRACE_SCOPE("calculate");
         auto now = high_resolution_clock::now();
-        b->tracker->update(frame);
-        b->lastUpdateMs = duration_cast<chrono::milliseconds>(high_resolution_clock::now() - now).count();
+
+        // A reverse runner calculates backwards in time, nothing a device could follow
+        bool streaming = live && !reverse;
+        vector<PositionSample> samples;
+
+        auto update = [&](time_t t) {
+            EventPtr turn;
+            if (!calculator.Update(set, t, streaming ? &turn : nullptr) || !streaming)
+                return;
+
+            if (turn)
+                samples.push_back({ turn->time, turn->position, true });
+
+            samples.push_back({ t, calculator.GetPosition(), false });
+        };
 
         if (saveResults)
-            b->state->SnapResult(set->events, time);
-    }
-    state.framesRdy++;
+        {
+            lock_guard<mutex> lock(calculatorMtx);
+            for (auto& s : fw->skipped)
+                update(s.first);
 
-    return;
-    */
+            if (!reverse)
+                set->timeEnd = fw->time;
 
-    if(blocking)
-        PushWork(1);
-    else
-        PushWork();
+            update(fw->time);
 
-    PopWork();
+            if (fw->checkpoint)
+                AddCheckpoint(fw);
+        }
 
-    if (!running && workMap.size() > 0 && (state.framesRdy <= 30 || blocking))
-        SetRunning(true);
+        // One datagram per tracked frame, the skipped frames of a stride ride along
+        if (!samples.empty())
+            live->SendFrame(set->timeStart, fw->time, samples, fw->decoded);
 
-    if (blocking)
-    {
-        auto now = steady_clock::now();
-        while (workMap.size() > 0)
+        if (fw->preview)
         {
-            PopWork();
-            this_thread::sleep_for(1ms);
+            vector<TrackingStatusBase> states;
+            vector<string> labels;
+            for (auto& w : fw->work)
+            {
+                if (!w->result)
+                    continue;
+
+                states.push_back(*w->result);
+                labels.push_back(w->label);
+            }
+
+            PublishPreview(fw->frame, fw->time, move(states), move(labels));
+        }
 
-            if (duration_cast<chrono::milliseconds>(high_resolution_clock::now() - now).count() > 1000)
-                throw "Failed";
+        double calculateMs = duration<double, milli>(high_resolution_clock::now() - now).count();
+        controller.Record(STAGE_CALCULATE, calculateMs);
+        calculateLatency.Record(calculateMs);
+        UpdateDepth();
+
+        frames++;
+        frameLatency.Record(duration<double, milli>(steady_clock::now() - fw->timeStart).count());
+        METRICS->SetGauge("queue.decoded", decoded.Size());
+        METRICS->SetGauge("queue.tracking", tracking.Size());
+        METRICS->SetGauge("queue.snapped", snapped.Size());
+        METRICS->SetGauge("inflight", inFlight);
+        METRICS->SetGauge("inflight.depth", controller.Depth());
+
+        {
+            lock_guard<mutex> lock(stateMtx);
+            state.framesRdy += 1 + fw->skipped.size();
+            state.framesTotal += 1 + fw->skipped.size();
+            state.lastTime = max(state.lastTime, fw->time);
+            state.lastWorkMs = duration_cast<chrono::milliseconds>(high_resolution_clock::now() - fw->timeStart).count();
+
+            inFlight--;
+            if (decodeDone && inFlight == 0)
+                state.finished = true;
         }
 
-        if (workMap.size() == 0)
-            SetRunning(false);
+        completed.Push(fw->time);
     }
 }
 
-void TrackingRunner::SetRunning(bool r)
+void TrackingRunner::Update(bool blocking)
 {
-    if (r == running)
+    if (!initialized && !Setup())
+        throw "Tracking setup failed";
+
+    PopWork();
+
+    if (!blocking)
+    {
+        // Do not run further ahead than the window while the ui has not picked up the results
+        if (!running && GetState().framesRdy <= controller.Depth())
+            SetRunning(true);
+
         return;
+    }
+
+    // Single step, flush whatever is in flight plus one new frame
+    SetRunning(false);
+
+    {
+        lock_guard<mutex> lock(decodeMtx);
+        decodeCredits++;
+    }
+    decodeCv.notify_all();
+
+    SetBindingsActive(true);
 
-    running = r;
-    
+    time_t time;
+    do {
+        if (!completed.PopFor(time, 1000ms))
+            throw "Failed";
+    } while (inFlight > 0);
+
+    SetBindingsActive(false);
+}
+
+void TrackingRunner::SetBindingsActive(bool active)
+{
     for (auto& b : bindings)
     {
-        if (running)
+        if (active)
             b->Start();
         else
             b->Join();
     }
 }
 
+void TrackingRunner::SetRunning(bool r)
+{
+    if (r == running)
+        return;
+
+    {
+        lock_guard<mutex> lock(decodeMtx);
+        running = r;
+    }
+    decodeCv.notify_all();
+
+    SetBindingsActive(running);
+}
+
 void TrackingRunner::AddTarget(TrackingTarget* target)
 {
     if (allTrackerTypes)
@@ -254,6 +1021,8 @@ void TrackingRunner::AddTarget(TrackingTarget* target)
 
             bindings.emplace_back(make_unique<TrackerBinding>(set, target, s, saveResults));
             bindings.back()->state->UpdateColor(bindings.size());
+            bindings.back()->SetQos(qosFps);
+            bindings.back()->SetMotionGate(gateThreshold);
         }
     }
     else
@@ -268,38 +1037,22 @@ void TrackingRunner::AddTarget(TrackingTarget* target)
 
         bindings.emplace_back(make_unique<TrackerBinding>(set, target, s, saveResults));
         bindings.back()->state->UpdateColor(bindings.size());
+        bindings.back()->SetQos(qosFps);
+        bindings.back()->SetMotionGate(gateThreshold);
     }
 }
 
 bool TrackingRunner::Setup()
 {
+    static atomic<int64_t>& resumes = METRICS->Counter("checkpoints.resumed");
+
     initialized = false;
     SetRunning(false);
-
-    if (saveResults)
-        set->events->ClearEvents([](EventPtr e) { return e->type == EventType::TET_BADFRAME; });
-
-    calculator.Reset();
+    StopPipeline();
 
     if (bindings.size() > 0)
         bindings.clear();
 
-    if (workMap.size() > 0)
-        workMap.clear();
-
-    state.framesRdy = 0;
-    state.lastTime = 0;
-    state.lastWorkMs = 999;
-
-    if (videoReader)
-    {
-        videoReader->Seek(set->timeStart);
-    }
-    else
-    {
-        w->timebar.SelectTrackingSet(set);
-    }
-
     if (target)
         AddTarget(target);
     else
@@ -309,15 +1062,110 @@ bool TrackingRunner::Setup()
     if (bindings.size() == 0)
         return false;
 
-    cuda::GpuMat firstFrame;
+    CheckpointPtr resume = FindResume();
+
+    if (saveResults)
+    {
+        // Results up to the checkpoint stay, everything after it is tracked again
+        auto lock = TraceLock(set->events->mtx, "EventList::mtx");
+        set->events->ClearEvents([resume](EventPtr e) {
+            return e->type == EventType::TET_BADFRAME || (resume && e->time <= resume->time);
+        });
+    }
+
+    if (saveResults && !reverse)
+    {
+        if (resume)
+            set->checkpoints->ClearAfter(resume->time);
+        else
+            set->checkpoints->Reset(set->GetSetup());
+    }
 
-    if (!videoReader)
-        firstFrame = w->GetInFrame();
+    calculator.Reset();
+    if (resume)
+    {
+        calculator.Unserialize(resume->calculator);
+        resumes++;
+    }
+
+    state = RunnerState();
+    decodeDone = false;
+
+    DecodedFrame firstFrame;
+    time_t firstTime;
+
+    if (resume)
+        videoReader->Seek(resume->time);
     else
-        firstFrame = videoReader->NextFrame();
+        videoReader->Seek(reverse ? set->timeEnd : set->timeStart);
+
+    firstFrame = videoReader->NextDecoded();
+    firstTime = videoReader->GetPosition();
+
+    // Seeking lands on the keyframe before, the targets were defined on the exact start frame
+    time_t exactStart = resume ? resume->time : set->timeStart;
+    while (!reverse && firstTime < exactStart)
+    {
+        firstFrame = videoReader->NextDecoded();
+        firstTime = videoReader->GetPosition();
+    }
 
     for (auto& b : bindings)
-        b->tracker->init(firstFrame);
+    {
+        if (resume)
+            b->Resume(*resume, firstFrame);
+        else
+            b->Init(firstFrame);
+
+        b->ApplyAnchor(firstTime, firstFrame);
+    }
+
+    strideCount = 0;
+    denseFrames = 0;
+    pendingSkipped.clear();
+    lastTrackedTime = firstTime;
+    nextCheckpoint = firstTime + checkpointInterval;
+
+    variants.clear();
+    for (auto& b : bindings)
+    {
+        // Scaled trackers read their own smaller variants, preparing the full one would only cost a download
+        if (b->tracker->GetScale() != 1)
+            continue;
+
+        FrameVariant v = b->tracker->GetFrameType();
+        if (v != FrameVariant::GPU_RGBA && find(variants.begin(), variants.end(), v) == variants.end())
+            variants.push_back(v);
+    }
+
+    if (recorder)
+        recorder->Write(firstTime, firstFrame, variants);
+
+    if (w)
+    {
+        previews.Reset();
+        shown = PreviewFrame();
+        lastPreview = steady_clock::now();
+
+        // The pipeline is not running yet, nothing else touches the trackers
+        vector<TrackingStatusBase> states;
+        vector<string> labels;
+        for (auto& b : bindings)
+        {
+            states.push_back(*b->state);
+            labels.push_back(b->Label());
+        }
+
+        PublishPreview(firstFrame, firstTime, move(states), move(labels));
+    }
+
+    // Start shallow for a quick first result, the controller grows the window from measured stage times
+    controller.Reset();
+    // Skipped frames ride along with the next tracked one without prepared variants
+    controller.SetFrameBytes(firstFrame.step * firstFrame.rows * (stride + variants.size()));
+    UpdateDepth();
+
+    StartPipeline();
 
     initialized = true;
     return initialized;
@@ -327,18 +1175,26 @@ void TrackingRunner::Draw(Mat& frame)
 {
     int y = 100;
 
-    putText(frame, format("Frame: %dms", state.lastWorkMs), Point(400, y), FONT_HERSHEY_SIMPLEX, 0.6, Scalar(255, 0, 0), 2);
+    putText(frame, format("Frame: %dms", GetState().lastWorkMs), Point(400, y), FONT_HERSHEY_SIMPLEX, 0.6, Scalar(255, 0, 0), 2);
     y += 20;
 
-    for (auto& b : bindings)
+    // The results that belong to the shown frame, the trackers are already further and can be
+    // replaced on the pool at any time, so nothing here touches them
+    bool fromPreview = shown.states.size() == bindings.size();
+
+    for (int i = 0; fromPreview && i < bindings.size(); i++)
     {
-        b->state->Draw(frame);
-        putText(frame, format("%s: %dms", b->tracker->GetName(), b->lastUpdateMs), Point(400, y), FONT_HERSHEY_SIMPLEX, 0.6, b->state->color, 2);
+        auto& s = shown.states.at(i);
+        s.Draw(frame);
+
+        string text = format("%s: %dms", shown.labels.at(i).c_str(), bindings.at(i)->lastUpdateMs.load());
+        putText(frame, text, Point(400, y), FONT_HERSHEY_SIMPLEX, 0.6, s.color, 2);
         y += 20;
     }
 
     if (saveResults)
     {
-        calculator.Draw(set, frame, state.lastTime);
+        lock_guard<mutex> lock(calculatorMtx);
+        calculator.Draw(set, frame, fromPreview ? shown.time : GetState().lastTime);
     }
 }
@@ -2,56 +2,172 @@
 
 #include "TrackingTarget.h"
 #include "Tracking/Trackers.h"
+#include "Tracking/FrameRecording.h"
+#include "Tracking/Redetector.h"
 #include "Model/Calculator.h"
+#include "Model/Checkpoint.h"
 #include "Reader/VideoReader.h"
-#include <thread>
+#include "Pipeline/WorkerPool.h"
+#include "Pipeline/BlockingQueue.h"
+#include "Pipeline/PipelineStage.h"
+#include "Pipeline/InFlightController.h"
+#include "Pipeline/TripleBuffer.h"
+#include "Diagnostics/Metrics.h"
+#include "Net/PositionStream.h"
 #include <opencv2/core/cuda.hpp>
+#include <atomic>
 #include <deque>
+#include <future>
+
+typedef BlockingQueue<time_t> CompletionQueue;
 
 struct ThreadWork {
-	ThreadWork(cv::cuda::GpuMat frame, time_t frameTime)
+	ThreadWork(DecodedFrame frame, time_t frameTime)
 		:frame(frame), frameTime(frameTime)
 	{
 
 	}
 
-	cv::cuda::GpuMat frame;
+	DecodedFrame frame;
 	time_t frameTime;
 
+	// Copy of the tracker state after this frame, written to the events by the snapshot stage
+	std::unique_ptr<TrackingStatus> result;
+	// Stride mode: state at the previous tracked frame to interpolate the skipped frames from,
+	// or the skipped frames tracked one by one when the segment had to be refined
+	std::unique_ptr<TrackingStatus> previous;
+	std::vector<std::pair<time_t, std::unique_ptr<TrackingStatus>>> refined;
+	bool refine = false;
+	// Tracker state after this frame when the frame is a checkpoint
+	std::unique_ptr<TrackerCheckpoint> checkpoint;
+	// Tracker name and scale for the window, taken on the strand since the tracker can be replaced any time after
+	std::string label;
+
 	int durationMs = 999;
-	bool done = false;
-	bool err = false;
+	double serviceMs = 0;
+	std::atomic<bool> done = false;
+	std::atomic<bool> err = false;
 };
 
 typedef std::shared_ptr<ThreadWork> ThreadWorkPtr;
 
+struct FrameWork
+{
+	FrameWork(DecodedFrame frame, time_t time)
+		:frame(frame), time(time), trackedFuture(tracked.get_future().share())
+	{
+
+	}
+
+	// Called by every binding once it tracked the frame, the last one releases the snapshot stage
+	void Finish()
+	{
+		if (--remaining == 0)
+			tracked.set_value();
+	}
+
+	DecodedFrame frame;
+	time_t time;
+	// Frames decoded since the previous tracked frame at previousTime, not tracked in stride mode
+	std::vector<std::pair<time_t, DecodedFrame>> skipped;
+	time_t previousTime = 0;
+	bool checkpoint = false;
+	// Handed to the window, see TrackingRunner::SetPreviewFps
+	bool preview = false;
+	std::vector<ThreadWorkPtr> work;
+	std::chrono::steady_clock::time_point timeStart;
+	// When the frame left the decoder, the live output measures its latency from here
+	std::chrono::steady_clock::time_point decoded = std::chrono::steady_clock::now();
+
+	std::atomic<int> remaining = 0;
+	std::promise<void> tracked;
+	std::shared_future<void> trackedFuture;
+};
+
+typedef std::shared_ptr<FrameWork> FrameWorkPtr;
+
+// A tracked frame with the tracker results on it, what the window shows while tracking
+struct PreviewFrame
+{
+	DecodedFrame frame;
+	time_t time = 0;
+	// One per binding
+	std::vector<TrackingStatusBase> states;
+	std::vector<std::string> labels;
+};
+
 class TrackerBinding
 {
 public:
 	TrackerBinding(TrackingSetPtr set, TrackingTarget* target, TrackerJTStruct& trackerStruct, bool saveResults);
 	~TrackerBinding();
 
+	void Init(DecodedFrame frame);
+	// Restarts the tracker from a known state on the given frame
+	void Reinit(TrackingStatus& from, DecodedFrame frame);
+	// Init from a checkpoint taken on this frame instead of the initial target
+	bool CanResume(Checkpoint& c);
+	void Resume(Checkpoint& c, DecodedFrame frame);
+	// Starts over on the target's anchor when it has one at this time
+	bool ApplyAnchor(time_t time, DecodedFrame frame);
+	// Lets the tracker lower its working resolution to keep up with this rate
+	void SetQos(double targetFps);
+	// Skip the tracker while the area around the target changes less than this mean grey difference, 0 always tracks
+	void SetMotionGate(double threshold) { gateThreshold = threshold; };
 	void Start();
 	void Join();
+	void Push(FrameWorkPtr fw, ThreadWorkPtr w);
 
-	std::mutex workMtx;
-
-	std::deque<ThreadWorkPtr> work;
-	
 	std::unique_ptr<TrackingStatus> state;
 	std::unique_ptr<TrackerJT> tracker;
 	TrackerJTStruct trackerStruct;
-	int lastUpdateMs = 0;
+	std::atomic<int> lastUpdateMs = 0;
 
 protected:
-	void RunThread();
-	bool running = false;
-	std::thread myThread;
+	LatencyHistogram* updateLatency;
+
+	void RunWork(FrameWorkPtr fw, ThreadWorkPtr w);
+	// Host frames go through the replay interface of the tracker with the variant it reads taken from the cache
+	void InitTracker(DecodedFrame frame);
+	bool UpdateTracker(DecodedFrame frame);
+	// True when interpolating between the two states would miss what happened in the skipped frames
+	bool NeedsRefine(TrackingStatus& before, bool ok, int frames);
+	// Looks for a lost target and restarts the tracker on it
+	bool Redetect(DecodedFrame frame);
+	void AddSample(DecodedFrame frame);
+	static cv::Rect StatusBox(TrackingStatusBase& s);
+	// Name and scale of the current tracker, only on the strand or while the pipeline is stopped
+	std::string Label();
+	// True when nothing moved around the target since the tracker last ran
+	bool Unchanged(DecodedFrame frame);
+
+	// Frames of one target are tracked in order, different targets run in parallel on the pool
+	Strand strand;
 
 	TrackingTarget* target;
 	TrackingSetPtr set;
 
+	// Last tracked frame and the motion up to it, for refining strided segments
+	DecodedFrame prevFrame;
+	cv::Point prevCenter;
+	cv::Point2f prevVelocity;
+
+	double qosFps = 0;
 	bool saveResults;
+
+	double gateThreshold = 0;
+	// Grey frame the tracker last ran on
+	DecodedFrame gateGrey;
+
+	Redetector redetector;
+	int sampleFrames = 0;
+	int lostFrames = 0;
+	// Frames between appearance samples while tracking, and between searches while lost
+	static const int sampleInterval = 15;
+	static const int redetectInterval = 5;
+
+	// Change of the per frame displacement in pixels that counts as a sharp turn
+	static constexpr float refineAcceleration = 3.0f;
 };
 
 struct RunnerState
@@ -59,22 +175,28 @@ struct RunnerState
 	int framesRdy = 0;
 	time_t lastTime = 0;
 	int lastWorkMs = 999;
+	int framesTotal = 0;
+	bool finished = false;
 };
 
-struct FrameWork
-{
-	time_t time;
-	std::vector<ThreadWorkPtr> work;
-	std::chrono::steady_clock::time_point timeStart;
-};
-
+// Frames flow through the stage graph
+//   decode -> prepare (frame variants) -> track (one strand per binding) -> snapshot (SnapResult) -> calculate
+// with bounded queues in between, so the next frames are decoded and converted while the current ones are tracked.
 class TrackingRunner
 {
 public:
-	TrackingRunner(TrackingWindow* w, TrackingSetPtr set, TrackingTarget* target, bool saveResults = false, bool allTrackerTypes = false, bool videoThread = false);
+	// Decodes with its own reader like the headless runner, the window only gets previews. Only built with cuda
+	TrackingRunner(TrackingWindow* w, TrackingSetPtr set, TrackingTarget* target, bool saveResults = false, bool allTrackerTypes = false);
+	// Headless runner with its own reader, a reverse runner tracks from set->timeEnd back towards the time limit
+	TrackingRunner(std::string video, TrackingSetPtr set, TrackingTarget* target, bool saveResults = false, bool allTrackerTypes = false, bool reverse = false);
+	// Headless runner on the given reader instead of a pooled one, a reverse runner wraps it in a reverse reader
+	TrackingRunner(cv::Ptr<VideoReader> reader, TrackingSetPtr set, TrackingTarget* target, bool saveResults = false, bool allTrackerTypes = false, bool reverse = false);
 	~TrackingRunner();
 
 	bool Setup();
+	// Stop decoding at this time, 0 runs until the end of the video
+	void SetTimeLimit(time_t t) { timeLimit = t; };
+	bool WaitFrame(std::chrono::milliseconds timeout);
 	void AddTarget(TrackingTarget* target);
 	void Update(bool blocking = false);
 	void Draw(cv::Mat& frame);
@@ -82,25 +204,135 @@ public:
 
 	RunnerState GetState(bool resetFramesRdy = false);
 
+	// Upper bound of frames held by the stage graph, including the prepared variants
+	static size_t EstimateMemory(cv::Size frameSize, size_t memoryBudget, int numVariants = 2)
+	{
+		size_t frames = (size_t)frameSize.area() * 4 * (maxDepth + decodeAhead * 2) * (1 + numVariants);
+		return std::min(frames, memoryBudget);
+	}
+
+	// Frames a reverse runner's reader holds while it serves a group of pictures backwards, on top of EstimateMemory
+	static size_t EstimateReverseMemory(cv::Size frameSize)
+	{
+		return (size_t)frameSize.area() * 4 * VideoReader::reverseBufferFrames;
+	}
+
+	// Frame memory the in-flight window may use
+	void SetMemoryBudget(size_t bytes);
+	// Writes every frame the trackers see, set before Setup to include the first frame
+	void SetRecorder(FrameRecorderPtr r) { recorder = r; };
+	// Track every nth frame and interpolate the ones in between, set before Setup. Every frame is still decoded,
+	// skipped frames only save tracker time
+	void SetStride(int s) { stride = std::max(1, s); };
+	// Trackers trade resolution for throughput to hold this rate, 0 always tracks at full resolution
+	void SetQos(double targetFps) { qosFps = targetFps; };
+	// Continue from the last checkpoint at or before this time instead of timeStart when the set has one, set before Setup
+	void SetResume(time_t t) { resumeTime = t; };
+	// See TrackerBinding::SetMotionGate, set before Setup. 1 is below compression noise on most sources
+	void SetMotionGate(double threshold) { gateThreshold = threshold; };
+	// Rate tracked frames are handed to the window at, tracking itself does not wait for the window
+	void SetPreviewFps(double fps) { previewFps = std::max(1.0, fps); };
+	// Picks up the newest preview for Draw and shows its frame, true when there was a new one
+	bool TakePreview();
+	// Sends the positions of every frame as soon as they are calculated, only forward runners that save results have any
+	void SetLiveOutput(PositionStreamPtr s) { live = s; };
+
 	std::vector<std::unique_ptr<TrackerBinding>> bindings;
 
 protected:
-	void PushWork(int frames = 20);
 	void PopWork();
+	void SetDecodeDone();
+	bool IsBadFrame(time_t time);
+	void SetBindingsActive(bool active);
+	void UpdateDepth();
+	void ReserveCache(int records);
+
+	// Returns the work for a decoded frame, or nullptr while the frame is skipped in stride mode
+	FrameWorkPtr AddDecoded(DecodedFrame frame, time_t time);
+	// Tracks the last skipped frame at the end of the video so the interpolation has an end
+	FrameWorkPtr FlushSkipped();
+	FrameWorkPtr MakeWork(DecodedFrame frame, time_t time);
+	bool PushDecoded(FrameWorkPtr fw);
+
+	// Returns the checkpoint Setup continues from, nullptr to track the whole set
+	CheckpointPtr FindResume();
+	void AddCheckpoint(FrameWorkPtr fw);
+	void PublishPreview(DecodedFrame frame, time_t time, std::vector<TrackingStatusBase> states, std::vector<std::string> labels);
+
+	void StartPipeline();
+	void StopPipeline();
+
+	void DecodeStage();
+	void PrepareStage();
+	void SnapshotStage();
+	void CalculateStage();
+
+	BlockingQueue<FrameWorkPtr> decoded;
+	BlockingQueue<FrameWorkPtr> tracking;
+	BlockingQueue<FrameWorkPtr> snapped;
+	CompletionQueue completed;
+
+	PipelineStage decodeStage{ "decode" };
+	PipelineStage prepareStage{ "prepare" };
+	PipelineStage snapshotStage{ "snapshot" };
+	PipelineStage calculateStage{ "calculate" };
+
+	std::mutex decodeMtx;
+	std::condition_variable decodeCv;
+	int decodeCredits = 0;
+	time_t timeLimit = 0;
+	bool decodeDone = false;
+	std::atomic<bool> stopping = false;
+	std::atomic<int> inFlight = 0;
+	std::vector<FrameVariant> variants;
+
+	InFlightController controller{ 2, maxDepth };
+	int cacheReserved = 0;
+
+	double qosFps = 0;
+	// Off unless asked for, gated frames reuse the previous result and change what gets tracked
+	double gateThreshold = 0;
+	int stride = 1;
+	int strideCount = 0;
+	// Frames left to track densely after a refined segment
+	std::atomic<int> denseFrames = 0;
+	std::vector<std::pair<time_t, DecodedFrame>> pendingSkipped;
+	time_t lastTrackedTime = 0;
+
+	time_t resumeTime = 0;
+	time_t nextCheckpoint = 0;
+
+	double previewFps = defaultPreviewFps;
+	std::chrono::steady_clock::time_point lastPreview;
+	TripleBuffer<PreviewFrame> previews;
+	// Owned by the ui thread
+	PreviewFrame shown;
 
-	std::map <time_t, FrameWork> workMap;
 	cv::Ptr<VideoReader> videoReader = nullptr;
-	
+	FrameRecorderPtr recorder;
+
 	TrackingSetPtr set;
 	TrackingTarget* target;
 	TrackingWindow* w;
+
+	std::mutex calculatorMtx;
 	TrackingCalculator calculator;
+	PositionStreamPtr live;
 
 	bool initialized = false;
+	bool reverse = false;
 	bool allTrackerTypes = false;
 	bool saveResults = false;
-	bool running = false;
+	std::atomic<bool> running = false;
+
+	std::mutex stateMtx;
 	RunnerState state;
 
-	const int maxWork = 40;
+	static const int maxDepth = 64;
+	static const int decodeAhead = 2;
+	// Tracked frames after a refined segment before striding again, in strides
+	static const int denseStrides = 4;
+	// Video time between checkpoints in ms
+	static const time_t checkpointInterval = 2000;
+	static constexpr double defaultPreviewFps = 15;
 };
@@ -18,11 +18,17 @@ TrackingSetPtr TrackingSet::Unserialize(json& s)
 			set->trackingMode = mode.value();
 	}
 
+	if (s.contains("anchor_end"))
+		set->anchorEnd = s["anchor_end"];
+
 	if (s["events"].is_array())
 	{
 		set->events = EventList::Unserialize(s["events"]);
 	}
 
+	if (s.contains("checkpoints"))
+		set->checkpoints = CheckpointList::Unserialize(s["checkpoints"]);
+
 	for (auto& t : s["targets"])
 	{
 		set->targets.push_back(TrackingTarget::Unserialize(t));
@@ -39,8 +45,14 @@ void TrackingSet::Serialize(json& set)
 	set["targets"] = json::array();
 	set["tracking_mode"] = magic_enum::enum_name(trackingMode);
 
+	if (anchorEnd != 0)
+		set["anchor_end"] = anchorEnd;
+
 	events->Serialize(set["events"]);
 
+	if (checkpoints->Size() > 0)
+		checkpoints->Serialize(set["checkpoints"]);
+
 	for (auto& t : targets)
 	{
 		json& target = set["targets"][set["targets"].size()];
@@ -56,6 +68,48 @@ void TrackingSet::Draw(Mat& frame)
 	}
 }
 
+bool TrackingSet::IsBidirectional()
+{
+	if (anchorEnd <= timeStart || targets.size() == 0)
+		return false;
+
+	return all_of(targets.begin(), targets.end(), [](TrackingTarget& t) { return t.HasEnd(); });
+}
+
+json TrackingSet::GetSetup()
+{
+	json j;
+	j["tracking_mode"] = magic_enum::enum_name(trackingMode);
+	j["targets"] = json::array();
+
+	for (auto& t : targets)
+	{
+		json& target = j["targets"][j["targets"].size()];
+		t.Serialize(target);
+
+		// Anchors only change the results from their time on, Reanchor drops the checkpoints they affect
+		target.erase("anchors");
+	}
+
+	return j;
+}
+
+void TrackingSet::Reanchor(TrackingTarget& target, time_t time, Rect box)
+{
+	if (box.empty())
+		target.anchors.erase(time);
+	else
+		target.anchors[time] = box;
+
+	// The checkpoint on the anchor frame was taken before the correction too
+	checkpoints->ClearAfter(time - 1);
+}
+
+bool TrackingSet::HasAnchor(time_t time)
+{
+	return any_of(targets.begin(), targets.end(), [time](TrackingTarget& t) { return t.anchors.count(time) > 0; });
+}
+
 TrackingTarget* TrackingSet::GetTarget(TARGET_TYPE type)
 {
 	if (targets.size() == 0)
@@ -3,6 +3,7 @@
 #include "Model.h"
 #include "TrackingEvent.h"
 #include "EventList.h"
+#include "Checkpoint.h"
 
 #include <opencv2/core.hpp>
 #include <vector>
@@ -22,14 +23,24 @@ public:
 	void Serialize(json& j);
 
 	void Draw(cv::Mat& frame);
+	// Every target has an end anchor, the set can be tracked from both ends
+	bool IsBidirectional();
+	// Everything the tracking results depend on besides the video, checkpoints are only valid for the same setup
+	json GetSetup();
+	// Corrects the target from this time on, an empty box removes the anchor
+	void Reanchor(TrackingTarget& target, time_t time, cv::Rect box);
+	bool HasAnchor(time_t time);
 
 	std::vector<TrackingTarget> targets;
 
 	TrackingMode trackingMode = TrackingMode::TM_DIAGONAL;
 	time_t timeStart;
 	time_t timeEnd;
+	// Time the end anchors of the targets were set at, 0 without
+	time_t anchorEnd = 0;
 
 	EventListPtr events;
+	CheckpointListPtr checkpoints = std::make_unique<CheckpointList>();
 };
 
 typedef std::shared_ptr<TrackingSet> TrackingSetPtr;
\ No newline at end of file
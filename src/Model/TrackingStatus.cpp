@@ -1,8 +1,10 @@
 #include "TrackingStatus.h"
 #include "TrackingEvent.h"
 #include "TrackingSet.h"
+#include "Diagnostics/Trace.h"
 
 #include <opencv2/imgproc.hpp>
+#include <magic_enum.hpp>
 
 using namespace cv;
 using namespace std;
@@ -63,9 +65,85 @@ void TrackingStatusBase::Draw(Mat& frame)
 	}
 }
 
+void TrackingStatusBase::Interpolate(TrackingStatusBase& from, TrackingStatusBase& to, double alpha)
+{
+	auto lerp = [alpha](double a, double b) { return a + (b - a) * alpha; };
+
+	center = Point(lerp(from.center.x, to.center.x), lerp(from.center.y, to.center.y));
+	size = lerp(from.size, to.size);
+
+	rect = Rect(
+		lerp(from.rect.x, to.rect.x),
+		lerp(from.rect.y, to.rect.y),
+		lerp(from.rect.width, to.rect.width),
+		lerp(from.rect.height, to.rect.height)
+	);
+
+	if (from.points.size() == to.points.size())
+	{
+		points = to.points;
+		for (int i = 0; i < points.size(); i++)
+		{
+			points[i].point = Point(lerp(from.points[i].point.x, to.points[i].point.x), lerp(from.points[i].point.y, to.points[i].point.y));
+			points[i].active = from.points[i].active && to.points[i].active;
+		}
+	}
+
+	active = from.active && to.active;
+}
+
+TrackingStatusBase TrackingStatusBase::Unserialize(json& j)
+{
+	auto trackingType = magic_enum::enum_cast<TRACKING_TYPE>((string)j["tracking_type"]);
+	auto targetType = magic_enum::enum_cast<TARGET_TYPE>((string)j["target_type"]);
+
+	TrackingStatusBase s(
+		trackingType.has_value() ? trackingType.value() : TRACKING_TYPE::TYPE_NONE,
+		targetType.has_value() ? targetType.value() : TARGET_TYPE::TYPE_UNKNOWN
+	);
+
+	s.rect = Rect(j["rect"]["x"], j["rect"]["y"], j["rect"]["width"], j["rect"]["height"]);
+	s.center = Point(j["center"]["x"], j["center"]["y"]);
+	s.size = j["size"];
+	s.active = j["active"];
+
+	for (auto& p : j["points"])
+	{
+		PointState ps;
+		ps.point = Point(p["x"], p["y"]);
+		ps.active = p["active"];
+		s.points.push_back(ps);
+	}
+
+	return s;
+}
+
+void TrackingStatusBase::Serialize(json& j)
+{
+	j["tracking_type"] = magic_enum::enum_name(trackingType);
+	j["target_type"] = magic_enum::enum_name(targetType);
+	j["rect"]["x"] = rect.x;
+	j["rect"]["y"] = rect.y;
+	j["rect"]["width"] = rect.width;
+	j["rect"]["height"] = rect.height;
+	j["center"]["x"] = center.x;
+	j["center"]["y"] = center.y;
+	j["size"] = size;
+	j["active"] = active;
+	j["points"] = json::array();
+
+	for (auto& p : points)
+	{
+		auto& pj = j["points"][j["points"].size()];
+		pj["x"] = p.point.x;
+		pj["y"] = p.point.y;
+		pj["active"] = p.active;
+	}
+}
+
 void TrackingStatus::SnapResult(EventListPtr& events, time_t time)
 {
-	lock_guard<mutex> lock(events->mtx);
+	auto lock = TraceLock(events->mtx, "EventList::mtx");
 
 	EventPtr e;
 
@@ -22,6 +22,11 @@ public:
 	}
 
 	void Draw(cv::Mat& frame);
+	// Blend between two results of the same target, alpha 0 is from and 1 is to
+	void Interpolate(TrackingStatusBase& from, TrackingStatusBase& to, double alpha);
+
+	static TrackingStatusBase Unserialize(json& j);
+	void Serialize(json& j);
 
 	TRACKING_TYPE trackingType;
 	TARGET_TYPE targetType;
@@ -101,6 +101,9 @@ TrackingTarget TrackingTarget::Unserialize(json& t)
 	if (preferredTracker.has_value())
 		target.preferredTracker = preferredTracker.value();
 
+	if (t.contains("coarse_to_fine"))
+		target.coarseToFine = t["coarse_to_fine"];
+
 	if (target.SupportsTrackingType(TRACKING_TYPE::TYPE_POINTS))
 	{
 		for (auto& p : t["points"])
@@ -116,6 +119,38 @@ TrackingTarget TrackingTarget::Unserialize(json& t)
 		);
 	}
 
+	if (t.contains("end_rect"))
+	{
+		target.endRect = Rect(
+			t["end_rect"]["x"],
+			t["end_rect"]["y"],
+			t["end_rect"]["width"],
+			t["end_rect"]["height"]
+		);
+	}
+
+	if (t.contains("tracker_params"))
+		target.trackerParams = t["tracker_params"];
+
+	for (auto& s : t["tracker_scores"])
+	{
+		TrackerScore score;
+		auto type = magic_enum::enum_cast<TrackerJTType>((string)s["tracker"]);
+		if (!type.has_value())
+			continue;
+
+		score.tracker = type.value();
+		score.ms = s["ms"];
+		score.forwardBackward = s["forward_backward"];
+		score.disagreement = s["disagreement"];
+		score.lost = s["lost"];
+		score.passed = s["passed"];
+		target.trackerScores.push_back(score);
+	}
+
+	for (auto& a : t["anchors"])
+		target.anchors[(time_t)a["time"]] = Rect(a["x"], a["y"], a["width"], a["height"]);
+
 	if (t.contains("range"))
 	{
 		target.range = Rect(
@@ -136,6 +171,7 @@ void TrackingTarget::Serialize(json& target)
 	target["target_type"] = magic_enum::enum_name(targetType);
 	target["tracking_type"] = magic_enum::enum_name(trackingType);
 	target["preferred_tracker"] = magic_enum::enum_name(preferredTracker);
+	target["coarse_to_fine"] = coarseToFine;
 
 	if (SupportsTrackingType(TRACKING_TYPE::TYPE_POINTS))
 	{
@@ -157,6 +193,48 @@ void TrackingTarget::Serialize(json& target)
 		target["rect"]["height"] = initialRect.height;
 	}
 
+	if (!endRect.empty())
+	{
+		target["end_rect"]["x"] = endRect.x;
+		target["end_rect"]["y"] = endRect.y;
+		target["end_rect"]["width"] = endRect.width;
+		target["end_rect"]["height"] = endRect.height;
+	}
+
+	if (!trackerParams.empty())
+		target["tracker_params"] = trackerParams;
+
+	if (!trackerScores.empty())
+	{
+		target["tracker_scores"] = json::array();
+
+		for (auto& s : trackerScores)
+		{
+			json& score = target["tracker_scores"][target["tracker_scores"].size()];
+			score["tracker"] = magic_enum::enum_name(s.tracker);
+			score["ms"] = s.ms;
+			score["forward_backward"] = s.forwardBackward;
+			score["disagreement"] = s.disagreement;
+			score["lost"] = s.lost;
+			score["passed"] = s.passed;
+		}
+	}
+
+	if (!anchors.empty())
+	{
+		target["anchors"] = json::array();
+
+		for (auto& a : anchors)
+		{
+			json& anchor = target["anchors"][target["anchors"].size()];
+			anchor["time"] = a.first;
+			anchor["x"] = a.second.x;
+			anchor["y"] = a.second.y;
+			anchor["width"] = a.second.width;
+			anchor["height"] = a.second.height;
+		}
+	}
+
 	if (!range.empty())
 	{
 		target["range"]["x"] = range.x;
@@ -164,4 +242,43 @@ void TrackingTarget::Serialize(json& target)
 		target["range"]["width"] = range.width;
 		target["range"]["height"] = range.height;
 	}
-}
\ No newline at end of file
+}
+
+json TrackingTarget::GetTrackerParams(TrackerJTType type)
+{
+	string name(magic_enum::enum_name(type));
+	if (!trackerParams.contains(name))
+		return json::object();
+
+	return trackerParams[name];
+}
+
+Rect TrackingTarget::InitialBox()
+{
+	if (SupportsTrackingType(TRACKING_TYPE::TYPE_RECT) && !initialRect.empty())
+		return initialRect;
+
+	if (initialPoints.size() > 0)
+		return boundingRect(initialPoints);
+
+	return initialRect;
+}
+
+TrackingTarget TrackingTarget::MovedTo(Rect to)
+{
+	TrackingTarget moved = *this;
+	Rect box = InitialBox();
+
+	moved.initialRect = to;
+
+	if (box.width > 0 && box.height > 0)
+	{
+		double sx = (double)to.width / box.width;
+		double sy = (double)to.height / box.height;
+
+		for (auto& p : moved.initialPoints)
+			p = to.tl() + Point(cvRound((p.x - box.x) * sx), cvRound((p.y - box.y) * sy));
+	}
+
+	return moved;
+}
@@ -4,11 +4,25 @@
 #include "Main.h"
 
 #include <opencv2/core.hpp>
+#include <map>
 #include <string>
 #include <vector>
 #include <json.hpp>
 using json = nlohmann::json;
 
+// How one tracker did on the first frames of a set, see TrackerProbe
+struct TrackerScore
+{
+	TrackerJTType tracker = TrackerJTType::TRACKER_TYPE_UNKNOWN;
+	// Mean update time
+	double ms = 0;
+	// Distances in target sizes
+	double forwardBackward = 0;
+	double disagreement = 0;
+	bool lost = false;
+	bool passed = false;
+};
+
 class TrackingTarget {
 public:
 	TrackingTarget();
@@ -32,6 +46,20 @@ public:
 		return guid;
 	}
 	TrackingStatus* InitTracking(TRACKING_TYPE t);
+	// Parameters the tracker is created with, empty for its defaults
+	json GetTrackerParams(TrackerJTType type);
+	cv::Rect InitialBox();
+	// Copy of the target that starts from this box, points keep their layout inside it
+	TrackingTarget MovedTo(cv::Rect box);
+	// Copy of the target that starts from the end anchor
+	TrackingTarget AtEnd()
+	{
+		return MovedTo(endRect);
+	}
+	bool HasEnd()
+	{
+		return !endRect.empty();
+	}
 
 	TARGET_TYPE targetType = TARGET_TYPE::TYPE_UNKNOWN;
 	TRACKING_TYPE trackingType = TRACKING_TYPE::TYPE_NONE;
@@ -40,7 +68,17 @@ public:
 	std::vector<cv::Point> initialPoints;
 	cv::Rect initialRect;
 	cv::Rect range;
+	// Where the target is at the anchor time at the end of the set, for bidirectional tracking
+	cv::Rect endRect;
+	// Corrections inside the set, the tracker starts over on the box at that time
+	std::map<time_t, cv::Rect> anchors;
 	TrackerJTType preferredTracker = TrackerJTType::TRACKER_TYPE_UNKNOWN;
+	// Track on a downscaled frame and refine the position at full resolution, rect trackers only
+	bool coarseToFine = false;
+	// Scores preferredTracker was picked by, empty when it was chosen by hand
+	std::vector<TrackerScore> trackerScores;
+	// Tuned parameters per tracker type name, see TrackerSweep
+	json trackerParams = json::object();
 
 private:
 	std::string guid;
@@ -0,0 +1,145 @@
+#include "DatagramSocket.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET SocketHandle;
+#define CLOSE_SOCKET closesocket
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <unistd.h>
+typedef int SocketHandle;
+#define CLOSE_SOCKET close
+#endif
+
+#include <cstring>
+
+using namespace std;
+
+namespace
+{
+    void InitSockets()
+    {
+#ifdef _WIN32
+        static bool started = []() {
+            WSADATA data;
+            return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+        }();
+#endif
+    }
+
+    SocketHandle ToSocket(intptr_t h)
+    {
+        return (SocketHandle)h;
+    }
+}
+
+DatagramSocket::~DatagramSocket()
+{
+    Close();
+}
+
+void DatagramSocket::Close()
+{
+    if (!IsOpen())
+        return;
+
+    CLOSE_SOCKET(ToSocket(handle));
+    handle = invalidHandle;
+}
+
+bool DatagramSocket::Open(string host, int port)
+{
+    InitSockets();
+    Close();
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), to_string(port).c_str(), &hints, &result) != 0)
+        return false;
+
+    // Connecting a datagram socket only fixes the destination, send then needs no address
+    for (addrinfo* a = result; a; a = a->ai_next)
+    {
+        SocketHandle s = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (s == (SocketHandle)invalidHandle)
+            continue;
+
+        if (connect(s, a->ai_addr, (int)a->ai_addrlen) == 0)
+        {
+            handle = (intptr_t)s;
+            break;
+        }
+
+        CLOSE_SOCKET(s);
+    }
+
+    freeaddrinfo(result);
+    return IsOpen();
+}
+
+bool DatagramSocket::Bind(int port)
+{
+    InitSockets();
+    Close();
+
+    SocketHandle s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == (SocketHandle)invalidHandle)
+        return false;
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+
+    if (::bind(s, (sockaddr*)&addr, sizeof(addr)) != 0)
+    {
+        CLOSE_SOCKET(s);
+        return false;
+    }
+
+    handle = (intptr_t)s;
+    return true;
+}
+
+bool DatagramSocket::Send(const string& message)
+{
+    if (!IsOpen() || message.size() > maxSize)
+        return false;
+
+    // A listener that is not there yet only costs this datagram
+    return send(ToSocket(handle), message.data(), (int)message.size(), 0) == (int)message.size();
+}
+
+bool DatagramSocket::Receive(string& out, int timeoutMs)
+{
+    if (!IsOpen())
+        return false;
+
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(ToSocket(handle), &fds);
+
+    timeval tv;
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+
+    if (select((int)handle + 1, &fds, nullptr, nullptr, &tv) <= 0)
+        return false;
+
+    char buffer[maxSize];
+    int n = recv(ToSocket(handle), buffer, sizeof(buffer), 0);
+    if (n <= 0)
+        return false;
+
+    out.assign(buffer, n);
+    return true;
+}
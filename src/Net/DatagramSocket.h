@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Connectionless UDP socket, one message per datagram. Nothing is resent, a lost datagram stays lost
+class DatagramSocket
+{
+public:
+    DatagramSocket() {};
+    ~DatagramSocket();
+
+    DatagramSocket(const DatagramSocket&) = delete;
+    DatagramSocket& operator=(const DatagramSocket&) = delete;
+
+    // Sends to this address from any local port
+    bool Open(std::string host, int port);
+    // Receives what is sent to this port on this machine
+    bool Bind(int port);
+
+    bool Send(const std::string& message);
+    // False when nothing came in within the timeout
+    bool Receive(std::string& out, int timeoutMs);
+
+    bool IsOpen() { return handle != invalidHandle; };
+    void Close();
+
+    // Larger datagrams may be dropped on the way even on loopback
+    static const size_t maxSize = 65000;
+
+protected:
+    static const intptr_t invalidHandle = -1;
+
+    intptr_t handle = invalidHandle;
+};
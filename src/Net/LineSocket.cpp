@@ -0,0 +1,250 @@
+#include "LineSocket.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET SocketHandle;
+typedef int SockLen;
+#define CLOSE_SOCKET closesocket
+#define SEND_FLAGS 0
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <unistd.h>
+typedef int SocketHandle;
+typedef socklen_t SockLen;
+#define CLOSE_SOCKET close
+// A closed peer fails the send instead of killing the process
+#define SEND_FLAGS MSG_NOSIGNAL
+#endif
+
+#include <cstring>
+
+using namespace std;
+
+namespace
+{
+    void InitSockets()
+    {
+#ifdef _WIN32
+        static bool started = []() {
+            WSADATA data;
+            return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+        }();
+#endif
+    }
+
+    SocketHandle ToSocket(intptr_t h)
+    {
+        return (SocketHandle)h;
+    }
+}
+
+LineSocket::~LineSocket()
+{
+    Close();
+}
+
+LineSocket::LineSocket(LineSocket&& other)
+{
+    *this = move(other);
+}
+
+LineSocket& LineSocket::operator=(LineSocket&& other)
+{
+    if (this == &other)
+        return *this;
+
+    Close();
+    handle = other.handle;
+    buffer = move(other.buffer);
+    other.handle = invalidHandle;
+    return *this;
+}
+
+void LineSocket::Close()
+{
+    if (!IsOpen())
+        return;
+
+    CLOSE_SOCKET(ToSocket(handle));
+    handle = invalidHandle;
+    buffer.clear();
+}
+
+bool LineSocket::Listen(int port, bool loopback)
+{
+    InitSockets();
+    Close();
+
+    SocketHandle s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == (SocketHandle)invalidHandle)
+        return false;
+
+    int reuse = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(loopback ? INADDR_LOOPBACK : INADDR_ANY);
+    addr.sin_port = htons(port);
+
+    if (::bind(s, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(s, 16) != 0)
+    {
+        CLOSE_SOCKET(s);
+        return false;
+    }
+
+    handle = (intptr_t)s;
+    return true;
+}
+
+int LineSocket::GetPort()
+{
+    sockaddr_in addr;
+    SockLen len = sizeof(addr);
+
+    if (!IsOpen() || getsockname(ToSocket(handle), (sockaddr*)&addr, &len) != 0)
+        return 0;
+
+    return ntohs(addr.sin_port);
+}
+
+bool LineSocket::Accept(LineSocket& out, int timeoutMs)
+{
+    if (!IsOpen())
+        return false;
+
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(ToSocket(handle), &fds);
+
+    timeval tv;
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+
+    if (select((int)handle + 1, &fds, nullptr, nullptr, &tv) <= 0)
+        return false;
+
+    SocketHandle s = accept(ToSocket(handle), nullptr, nullptr);
+    if (s == (SocketHandle)invalidHandle)
+        return false;
+
+    out.Close();
+    out.handle = (intptr_t)s;
+    return true;
+}
+
+bool LineSocket::Connect(string host, int port)
+{
+    InitSockets();
+    Close();
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), to_string(port).c_str(), &hints, &result) != 0)
+        return false;
+
+    for (addrinfo* a = result; a; a = a->ai_next)
+    {
+        SocketHandle s = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (s == (SocketHandle)invalidHandle)
+            continue;
+
+        if (connect(s, a->ai_addr, (SockLen)a->ai_addrlen) == 0)
+        {
+            handle = (intptr_t)s;
+            break;
+        }
+
+        CLOSE_SOCKET(s);
+    }
+
+    freeaddrinfo(result);
+    return IsOpen();
+}
+
+bool LineSocket::Send(const json& message)
+{
+    if (!IsOpen())
+        return false;
+
+    string line = message.dump() + "\n";
+    size_t sent = 0;
+
+    while (sent < line.size())
+    {
+        int n = send(ToSocket(handle), line.data() + sent, (int)(line.size() - sent), SEND_FLAGS);
+        if (n <= 0)
+        {
+            Close();
+            return false;
+        }
+
+        sent += n;
+    }
+
+    return true;
+}
+
+bool LineSocket::Receive(json& out)
+{
+    return Receive(out, -1);
+}
+
+bool LineSocket::Receive(json& out, int timeoutMs)
+{
+    size_t end;
+    while ((end = buffer.find('\n')) == string::npos)
+    {
+        if (!IsOpen())
+            return false;
+
+        if (timeoutMs >= 0)
+        {
+            fd_set fds;
+            FD_ZERO(&fds);
+            FD_SET(ToSocket(handle), &fds);
+
+            timeval tv;
+            tv.tv_sec = timeoutMs / 1000;
+            tv.tv_usec = (timeoutMs % 1000) * 1000;
+
+            if (select((int)handle + 1, &fds, nullptr, nullptr, &tv) <= 0)
+                return false;
+        }
+
+        char chunk[16384];
+        int n = recv(ToSocket(handle), chunk, sizeof(chunk), 0);
+        if (n <= 0)
+        {
+            Close();
+            return false;
+        }
+
+        buffer.append(chunk, n);
+    }
+
+    out = json::parse(buffer.begin(), buffer.begin() + end, nullptr, false);
+    buffer.erase(0, end + 1);
+
+    return !out.is_discarded();
+}
+
+bool LineSocket::ParseAddress(string address, string& host, int& port)
+{
+    size_t colon = address.rfind(':');
+    if (colon == string::npos)
+        return false;
+
+    host = address.substr(0, colon);
+    port = atoi(address.substr(colon + 1).c_str());
+    return port > 0;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <json.hpp>
+using json = nlohmann::json;
+
+// Blocking TCP connection that exchanges one json message per line
+class LineSocket
+{
+public:
+    LineSocket() {};
+    ~LineSocket();
+
+    LineSocket(const LineSocket&) = delete;
+    LineSocket& operator=(const LineSocket&) = delete;
+    LineSocket(LineSocket&& other);
+    LineSocket& operator=(LineSocket&& other);
+
+    // Listens on every interface or only on this machine, port 0 picks a free one
+    bool Listen(int port, bool loopback = false);
+    int GetPort();
+    // False when no connection came in within the timeout
+    bool Accept(LineSocket& out, int timeoutMs);
+    bool Connect(std::string host, int port);
+
+    bool Send(const json& message);
+    // Blocks for the next message, false once the connection is closed or sent garbage
+    bool Receive(json& out);
+    // Also false when nothing complete came in within the timeout, the connection then stays open
+    bool Receive(json& out, int timeoutMs);
+
+    bool IsOpen() { return handle != invalidHandle; };
+    void Close();
+
+    // "host:port" to its parts, false when there is no port
+    static bool ParseAddress(std::string address, std::string& host, int& port);
+
+protected:
+    static const intptr_t invalidHandle = -1;
+
+    intptr_t handle = invalidHandle;
+    std::string buffer;
+};
@@ -0,0 +1,158 @@
+#include "PositionStream.h"
+#include "LineSocket.h"
+
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+using namespace chrono;
+
+namespace
+{
+    int64_t WallMs()
+    {
+        return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+    }
+}
+
+bool PositionStream::Open(string a)
+{
+    string host;
+    int port;
+
+    if (!LineSocket::ParseAddress(a, host, port))
+        return false;
+
+    address = a;
+    return socket.Open(host, port);
+}
+
+void PositionStream::SendFrame(time_t setStart, time_t frameTime, vector<PositionSample>& samples, steady_clock::time_point decoded)
+{
+    static LatencyHistogram& liveLatency = METRICS->Histogram("live");
+    static atomic<int64_t>& sent = METRICS->Counter("live.sent");
+    static atomic<int64_t>& dropped = METRICS->Counter("live.failed");
+
+    json message = {
+        { "type", "positions" },
+        { "set", setStart },
+        { "frame", frameTime },
+        { "samples", json::array() }
+    };
+
+    for (auto& s : samples)
+    {
+        json& j = message["samples"][message["samples"].size()];
+        j["at"] = s.at;
+        j["pos"] = (int)(s.position * 100);
+        j["turn"] = s.turn;
+    }
+
+    // Runners of different sets can share the stream, seq has to follow the order on the wire
+    lock_guard<mutex> lock(mtx);
+
+    double ms = duration<double, milli>(steady_clock::now() - decoded).count();
+    message["seq"] = seq++;
+    message["sent_ms"] = WallMs();
+    message["latency_ms"] = ms;
+
+    if (socket.Send(message.dump()))
+    {
+        sent++;
+        latency.Record(ms);
+        liveLatency.Record(ms);
+    }
+    else
+    {
+        failed++;
+        dropped++;
+    }
+}
+
+void PositionStream::PrintSummary()
+{
+    lock_guard<mutex> lock(mtx);
+
+    cout << "Live output to " << address << ": " << seq << " frames, " << failed << " not sent" << endl;
+
+    if (latency.Count() > 0)
+    {
+        cout << fixed << setprecision(2)
+            << "  decode to send p50 " << latency.PercentileMs(0.5) << "ms p99 " << latency.PercentileMs(0.99)
+            << "ms max " << latency.MaxMs() << "ms" << endl;
+    }
+}
+
+// MockDevice
+
+MockDevice::MockDevice(int port)
+    :port(port)
+{
+
+}
+
+bool MockDevice::Run(int idleMs)
+{
+    DatagramSocket socket;
+    if (!socket.Bind(port))
+    {
+        cout << "Cannot listen on port " << port << endl;
+        return false;
+    }
+
+    cout << "Mock device listening on port " << port << endl;
+
+    LatencyHistogram pipeline;
+    LatencyHistogram transport;
+    int64_t received = 0, lost = 0, reordered = 0, next = -1;
+    int lastPos = -1;
+
+    string data;
+    while (true)
+    {
+        if (!socket.Receive(data, received > 0 ? idleMs : 1000))
+        {
+            if (received > 0)
+                break;
+
+            continue;
+        }
+
+        json message = json::parse(data, nullptr, false);
+        if (message.is_discarded() || message.value("type", "") != "positions")
+            continue;
+
+        received++;
+
+        int64_t seq = message.value("seq", (int64_t)0);
+        if (next >= 0 && seq > next)
+            lost += seq - next;
+        else if (next >= 0 && seq < next)
+            reordered++;
+
+        next = max(next, seq + 1);
+
+        pipeline.Record(message.value("latency_ms", 0.0));
+        // Sender and device share the clock on this machine
+        transport.Record((double)max((int64_t)0, WallMs() - message.value("sent_ms", WallMs())));
+
+        for (auto& s : message["samples"])
+        {
+            int pos = s.value("pos", 0);
+
+            // Only print what a device would act on
+            if (s.value("turn", false) || abs(pos - lastPos) >= 10)
+            {
+                cout << setw(10) << s.value("at", (int64_t)0) << "ms " << setw(3) << pos << (s.value("turn", false) ? " turn" : "") << endl;
+                lastPos = pos;
+            }
+        }
+    }
+
+    cout << fixed << setprecision(2)
+        << received << " frames, " << lost << " lost, " << reordered << " out of order" << endl
+        << "  decode to send p50 " << pipeline.PercentileMs(0.5) << "ms p99 " << pipeline.PercentileMs(0.99) << "ms" << endl
+        << "  send to receive p50 " << transport.PercentileMs(0.5) << "ms p99 " << transport.PercentileMs(0.99) << "ms" << endl;
+
+    return true;
+}
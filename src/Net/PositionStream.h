@@ -0,0 +1,63 @@
+#pragma once
+
+#include "DatagramSocket.h"
+#include "Diagnostics/Metrics.h"
+
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct PositionSample
+{
+    // Video time in ms
+    time_t at = 0;
+    // 0 to 1, the same as the funscript actions divided by 100
+    float position = 0;
+    // A TET_POSITION event, the stroke turned here. Other samples are the live position on every frame
+    bool turn = false;
+};
+
+// Sends the positions of every tracked frame as one UDP datagram while tracking, for driving a device
+// without waiting for Project::Save. A datagram is
+//   {"type":"positions","seq":n,"set":setStart,"frame":time,"sent_ms":unix ms,"latency_ms":decode to send,
+//    "samples":[{"at":time,"pos":0-100,"turn":bool}]}
+// Missing seq numbers are lost datagrams, positions are never resent since a late one is useless to a device.
+class PositionStream
+{
+public:
+    // host:port of the listener
+    bool Open(std::string address);
+
+    // decoded is when the frame came out of the decoder
+    void SendFrame(time_t setStart, time_t frameTime, std::vector<PositionSample>& samples, std::chrono::steady_clock::time_point decoded);
+
+    // Datagrams sent and the decode to send latency so far
+    void PrintSummary();
+
+protected:
+    DatagramSocket socket;
+    std::string address;
+
+    std::mutex mtx;
+    int64_t seq = 0;
+    int64_t failed = 0;
+    LatencyHistogram latency;
+};
+
+typedef std::shared_ptr<PositionStream> PositionStreamPtr;
+
+// Stands in for a device: listens for a PositionStream on this machine and reports what arrives
+class MockDevice
+{
+public:
+    MockDevice(int port);
+
+    // Runs until nothing arrived for idleMs after the first datagram, false when the port is taken
+    bool Run(int idleMs = 10000);
+
+protected:
+    int port;
+};
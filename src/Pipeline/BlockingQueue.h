@@ -0,0 +1,119 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// Thread safe FIFO, a capacity of 0 means unbounded
+template<typename T>
+class BlockingQueue
+{
+public:
+    BlockingQueue(size_t capacity = 0)
+        :capacity(capacity)
+    {
+
+    }
+
+    bool Push(T item)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        notFull.wait(lock, [this]() { return closed || capacity == 0 || items.size() < capacity; });
+
+        if (closed)
+            return false;
+
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    bool TryPush(T item)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (closed || (capacity != 0 && items.size() >= capacity))
+            return false;
+
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    bool Pop(T& out)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        notEmpty.wait(lock, [this]() { return closed || !items.empty(); });
+
+        return Take(out);
+    }
+
+    bool TryPop(T& out)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return Take(out);
+    }
+
+    template<typename Rep, typename Period>
+    bool PopFor(T& out, std::chrono::duration<Rep, Period> timeout)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        notEmpty.wait_for(lock, timeout, [this]() { return closed || !items.empty(); });
+
+        return Take(out);
+    }
+
+    // Wakes up all waiters, Pop keeps returning the remaining items
+    void Close()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        closed = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+    void Reopen()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        closed = false;
+    }
+
+    void Clear()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        items.clear();
+        notFull.notify_all();
+    }
+
+    size_t Size()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return items.size();
+    }
+
+    void SetCapacity(size_t c)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        capacity = c;
+        notFull.notify_all();
+    }
+
+protected:
+    bool Take(T& out)
+    {
+        if (items.empty())
+            return false;
+
+        out = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    std::mutex mtx;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::deque<T> items;
+    size_t capacity;
+    bool closed = false;
+};
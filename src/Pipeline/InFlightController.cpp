@@ -0,0 +1,100 @@
+#include "InFlightController.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+// Weight of a new sample in the moving averages
+static const double alpha = 0.1;
+
+InFlightController::InFlightController(int minDepth, int maxDepth)
+    :minDepth(minDepth), maxDepth(maxDepth), depth(minDepth)
+{
+
+}
+
+void InFlightController::Reset()
+{
+    lock_guard<mutex> lock(mtx);
+
+    for (auto& s : stages)
+        s = StageTiming();
+
+    depth = minDepth;
+}
+
+void InFlightController::Record(PipelineStageType stage, double serviceMs)
+{
+    lock_guard<mutex> lock(mtx);
+
+    StageTiming& s = stages[stage];
+    if (s.samples == 0)
+    {
+        s.mean = serviceMs;
+        s.deviation = 0;
+    }
+    else
+    {
+        s.deviation = (1 - alpha) * s.deviation + alpha * abs(serviceMs - s.mean);
+        s.mean = (1 - alpha) * s.mean + alpha * serviceMs;
+    }
+
+    s.samples++;
+    Recalculate();
+}
+
+void InFlightController::SetFrameBytes(size_t bytes)
+{
+    lock_guard<mutex> lock(mtx);
+    frameBytes = bytes;
+    Recalculate();
+}
+
+void InFlightController::SetMemoryBudget(size_t bytes)
+{
+    lock_guard<mutex> lock(mtx);
+    memoryBudget = bytes;
+    Recalculate();
+}
+
+int InFlightController::Depth()
+{
+    lock_guard<mutex> lock(mtx);
+    return depth;
+}
+
+double InFlightController::BottleneckMs()
+{
+    lock_guard<mutex> lock(mtx);
+
+    double bottleneck = 0;
+    for (auto& s : stages)
+        bottleneck = max(bottleneck, s.mean);
+
+    return bottleneck;
+}
+
+void InFlightController::Recalculate()
+{
+    double bottleneck = 0;
+    double latency = 0;
+
+    for (auto& s : stages)
+    {
+        // Cover the jitter of every stage so a slow frame does not drain the pipeline
+        double t = s.mean + 2 * s.deviation;
+        bottleneck = max(bottleneck, s.mean);
+        latency += t;
+    }
+
+    int wanted = minDepth;
+    if (bottleneck > 0)
+        wanted = (int)ceil(latency / bottleneck) + 1;
+
+    int limit = maxDepth;
+    if (frameBytes > 0)
+        limit = min(limit, (int)(memoryBudget / frameBytes));
+
+    depth = max(minDepth, min(wanted, limit));
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <mutex>
+
+enum PipelineStageType
+{
+    STAGE_DECODE,
+    STAGE_PREPARE,
+    STAGE_TRACK,
+    STAGE_SNAPSHOT,
+    STAGE_CALCULATE,
+    STAGE_COUNT
+};
+
+// Sizes the number of frames in flight from the measured service time of every stage.
+// By Little's law the pipeline needs latency / bottleneck frames to keep the slowest stage busy,
+// anything above that only costs memory and time to first result.
+class InFlightController
+{
+public:
+    InFlightController(int minDepth = 2, int maxDepth = 64);
+
+    void Reset();
+    void Record(PipelineStageType stage, double serviceMs);
+
+    void SetFrameBytes(size_t bytes);
+    void SetMemoryBudget(size_t bytes);
+
+    int Depth();
+    int MaxDepth() { return maxDepth; };
+    double BottleneckMs();
+
+protected:
+    void Recalculate();
+
+    struct StageTiming
+    {
+        double mean = 0;
+        double deviation = 0;
+        int samples = 0;
+    };
+
+    std::mutex mtx;
+    StageTiming stages[STAGE_COUNT];
+
+    int minDepth;
+    int maxDepth;
+    int depth;
+
+    size_t frameBytes = 0;
+    size_t memoryBudget = (size_t)1024 * 1024 * 1024;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Diagnostics/Trace.h"
+#include <functional>
+#include <string>
+#include <thread>
+
+// One node of the tracking stage graph, runs its body on a dedicated thread until the body returns
+class PipelineStage
+{
+public:
+    PipelineStage(std::string name)
+        :name(name)
+    {
+
+    }
+
+    ~PipelineStage()
+    {
+        Join();
+    }
+
+    void Start(std::function<void()> body)
+    {
+        Join();
+        myThread = std::thread([this, body]() {
+            Tracer::SetThreadName(name);
+            body();
+        });
+    }
+
+    void Join()
+    {
+        if (myThread.joinable())
+            myThread.join();
+    }
+
+    const std::string& GetName()
+    {
+        return name;
+    }
+
+protected:
+    std::string name;
+    std::thread myThread;
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Diagnostics/Metrics.h"
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+// Keeps objects that are expensive to create alive after their last user is gone, the next Take with the
+// same key gets an idle one instead of a new one. Users have to put a taken object back into a known state
+// themselves (seek a reader, init a tracker). Without capacity nothing is kept and Take always creates.
+template<typename T>
+class ResourcePool
+{
+public:
+    typedef std::function<std::shared_ptr<T>()> CreateFunc;
+
+    // Pools are globals, the counters are only looked up once METRICS surely exists
+    ResourcePool(std::string name)
+        :name(name)
+    {
+
+    }
+
+    // Idle objects kept over all keys, the least recently used ones go first
+    void SetCapacity(size_t c)
+    {
+        std::list<Entry> evicted;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            capacity = c;
+            Trim(evicted);
+        }
+    }
+
+    // The returned pointer goes back to the pool instead of being freed
+    std::shared_ptr<T> Take(const std::string& key, CreateFunc create)
+    {
+        std::shared_ptr<T> item;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (capacity == 0)
+                return create();
+
+            for (auto it = idle.begin(); it != idle.end(); it++)
+            {
+                if (it->first != key)
+                    continue;
+
+                item = it->second;
+                idle.erase(it);
+                break;
+            }
+        }
+
+        if (item)
+        {
+            METRICS->Counter(name + ".reused")++;
+        }
+        else
+        {
+            item = create();
+            METRICS->Counter(name + ".created")++;
+            if (!item)
+                return item;
+        }
+
+        // The deleter holds the real reference until it is back in the pool
+        return std::shared_ptr<T>(item.get(), [this, key, item](T*) { Return(key, item); });
+    }
+
+    void Clear()
+    {
+        std::list<Entry> evicted;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            evicted.swap(idle);
+        }
+    }
+
+protected:
+    typedef std::pair<std::string, std::shared_ptr<T>> Entry;
+
+    void Return(const std::string& key, std::shared_ptr<T> item)
+    {
+        // Objects are freed outside the lock, a decoder or a net can take a while to go
+        std::list<Entry> evicted;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            idle.emplace_front(key, item);
+            Trim(evicted);
+        }
+    }
+
+    void Trim(std::list<Entry>& evicted)
+    {
+        while (idle.size() > capacity)
+        {
+            evicted.push_back(std::move(idle.back()));
+            idle.pop_back();
+        }
+    }
+
+    std::mutex mtx;
+    size_t capacity = 0;
+    // Most recently returned first
+    std::list<Entry> idle;
+
+    std::string name;
+};
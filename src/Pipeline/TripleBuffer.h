@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+
+// Latest value handoff between one writer and one reader without locks.
+// The writer never waits for the reader and the reader only ever sees the newest complete value,
+// values published in between are dropped.
+template<typename T>
+class TripleBuffer
+{
+public:
+    void Publish(T value)
+    {
+        buffers[back] = std::move(value);
+        back = middle.exchange(back | freshBit) & indexMask;
+    }
+
+    // False when nothing new was published since the last call
+    bool Take(T& out)
+    {
+        if (!(middle.load() & freshBit))
+            return false;
+
+        front = middle.exchange(front) & indexMask;
+        out = std::move(buffers[front]);
+        return true;
+    }
+
+    // Only while neither side runs
+    void Reset()
+    {
+        for (auto& b : buffers)
+            b = T();
+
+        back = 0;
+        middle = 1;
+        front = 2;
+    }
+
+protected:
+    static const int indexMask = 3;
+    static const int freshBit = 4;
+
+    T buffers[3];
+    int back = 0;
+    std::atomic<int> middle = 1;
+    int front = 2;
+};
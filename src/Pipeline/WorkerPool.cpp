@@ -0,0 +1,240 @@
+#include "WorkerPool.h"
+#include "Diagnostics/Trace.h"
+
+using namespace std;
+
+WorkerPool* WORKER_POOL = new WorkerPool();
+
+static thread_local WorkerPool* currentPool = nullptr;
+static thread_local unsigned int currentWorker = 0;
+
+// WorkerPool
+
+WorkerPool::WorkerPool(unsigned int numThreads)
+{
+    if (numThreads == 0)
+        numThreads = max(2u, thread::hardware_concurrency());
+
+    for (unsigned int i = 0; i < numThreads; i++)
+        workers.emplace_back(make_unique<Worker>());
+
+    for (unsigned int i = 0; i < numThreads; i++)
+        workers.at(i)->thread = thread(&WorkerPool::RunThread, this, i);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        lock_guard<mutex> lock(sleepMtx);
+        running = false;
+    }
+    sleepCv.notify_all();
+
+    for (auto& w : workers)
+        w->thread.join();
+}
+
+void WorkerPool::Submit(PoolTask task)
+{
+    // Tasks spawned from a worker stay local, everything else is spread round robin
+    unsigned int index;
+    if (currentPool == this)
+        index = currentWorker;
+    else
+        index = nextWorker++ % workers.size();
+
+    {
+        lock_guard<mutex> lock(workers.at(index)->mtx);
+        workers.at(index)->tasks.push_back(move(task));
+    }
+
+    {
+        lock_guard<mutex> lock(sleepMtx);
+        pending++;
+    }
+    sleepCv.notify_one();
+}
+
+void WorkerPool::RunAll(vector<PoolTask> tasks)
+{
+    struct Batch
+    {
+        Batch(vector<PoolTask> tasks)
+            :tasks(move(tasks)), claimed(this->tasks.size()), remaining(this->tasks.size())
+        {
+
+        }
+
+        void Run(size_t i)
+        {
+            if (claimed.at(i).exchange(true))
+                return;
+
+            tasks.at(i)();
+
+            if (--remaining == 0)
+            {
+                lock_guard<mutex> lock(mtx);
+                doneCv.notify_all();
+            }
+        }
+
+        vector<PoolTask> tasks;
+        vector<atomic<bool>> claimed;
+        atomic<int> remaining;
+        mutex mtx;
+        condition_variable doneCv;
+    };
+
+    if (tasks.empty())
+        return;
+
+    auto batch = make_shared<Batch>(move(tasks));
+
+    for (size_t i = 1; i < batch->tasks.size(); i++)
+        Submit([batch, i]() { batch->Run(i); });
+
+    for (size_t i = 0; i < batch->tasks.size(); i++)
+        batch->Run(i);
+
+    unique_lock<mutex> lock(batch->mtx);
+    batch->doneCv.wait(lock, [&batch]() { return batch->remaining == 0; });
+}
+
+bool WorkerPool::PopLocal(unsigned int index, PoolTask& out)
+{
+    Worker& w = *workers.at(index);
+    lock_guard<mutex> lock(w.mtx);
+
+    if (w.tasks.empty())
+        return false;
+
+    out = move(w.tasks.back());
+    w.tasks.pop_back();
+    return true;
+}
+
+bool WorkerPool::Steal(unsigned int index, PoolTask& out)
+{
+    for (unsigned int i = 1; i < workers.size(); i++)
+    {
+        Worker& w = *workers.at((index + i) % workers.size());
+        lock_guard<mutex> lock(w.mtx);
+
+        if (w.tasks.empty())
+            continue;
+
+        out = move(w.tasks.front());
+        w.tasks.pop_front();
+        return true;
+    }
+
+    return false;
+}
+
+void WorkerPool::RunThread(unsigned int index)
+{
+    currentPool = this;
+    currentWorker = index;
+    Tracer::SetThreadName("worker " + to_string(index));
+
+    while (true)
+    {
+        PoolTask task;
+
+        if (PopLocal(index, task) || Steal(index, task))
+        {
+            pending--;
+            task();
+            continue;
+        }
+
+        unique_lock<mutex> lock(sleepMtx);
+        sleepCv.wait(lock, [this]() { return pending > 0 || !running; });
+
+        if (!running && pending <= 0)
+            return;
+    }
+}
+
+// Strand
+
+Strand::Strand(WorkerPool* pool)
+    :pool(pool)
+{
+
+}
+
+Strand::~Strand()
+{
+    Clear();
+    WaitIdle();
+}
+
+void Strand::Post(PoolTask task)
+{
+    lock_guard<mutex> lock(mtx);
+    tasks.push_back(move(task));
+    Schedule();
+}
+
+void Strand::SetActive(bool a)
+{
+    lock_guard<mutex> lock(mtx);
+    active = a;
+    Schedule();
+}
+
+void Strand::WaitIdle()
+{
+    unique_lock<mutex> lock(mtx);
+    idleCv.wait(lock, [this]() { return !scheduled; });
+}
+
+void Strand::Clear()
+{
+    lock_guard<mutex> lock(mtx);
+    tasks.clear();
+}
+
+size_t Strand::Pending()
+{
+    lock_guard<mutex> lock(mtx);
+    return tasks.size();
+}
+
+void Strand::Schedule()
+{
+    if (scheduled || !active || tasks.empty())
+        return;
+
+    scheduled = true;
+    pool->Submit([this]() { RunOnce(); });
+}
+
+void Strand::RunOnce()
+{
+    PoolTask task;
+    {
+        lock_guard<mutex> lock(mtx);
+        if (!active || tasks.empty())
+        {
+            scheduled = false;
+            idleCv.notify_all();
+            return;
+        }
+
+        task = move(tasks.front());
+        tasks.pop_front();
+    }
+
+    task();
+
+    // Reschedule instead of looping so other strands get their turn
+    lock_guard<mutex> lock(mtx);
+    scheduled = false;
+    Schedule();
+
+    if (!scheduled)
+        idleCv.notify_all();
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef std::function<void()> PoolTask;
+
+// Fixed size pool, every worker owns a deque and steals from the others when it runs dry
+class WorkerPool
+{
+public:
+    WorkerPool(unsigned int numThreads = 0);
+    ~WorkerPool();
+
+    void Submit(PoolTask task);
+    // Runs the tasks in parallel and returns once all finished. The caller runs whatever no worker
+    // picked up yet, so this is safe to call from inside a pool task.
+    void RunAll(std::vector<PoolTask> tasks);
+
+    template<typename F>
+    auto Async(F f) -> std::future<decltype(f())>
+    {
+        auto task = std::make_shared<std::packaged_task<decltype(f())()>>(f);
+        auto future = task->get_future();
+        Submit([task]() { (*task)(); });
+        return future;
+    }
+
+    unsigned int Size()
+    {
+        return workers.size();
+    }
+
+protected:
+    struct Worker
+    {
+        std::mutex mtx;
+        std::deque<PoolTask> tasks;
+        std::thread thread;
+    };
+
+    void RunThread(unsigned int index);
+    bool PopLocal(unsigned int index, PoolTask& out);
+    bool Steal(unsigned int index, PoolTask& out);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    std::mutex sleepMtx;
+    std::condition_variable sleepCv;
+    std::atomic<int> pending{ 0 };
+    std::atomic<unsigned int> nextWorker{ 0 };
+    std::atomic<bool> running{ true };
+};
+
+// Runs posted tasks one after another on the pool, in the order they were posted
+class Strand
+{
+public:
+    Strand(WorkerPool* pool);
+    ~Strand();
+
+    void Post(PoolTask task);
+
+    // Pause / resume scheduling, tasks posted while paused are kept
+    void SetActive(bool active);
+    void WaitIdle();
+    void Clear();
+
+    size_t Pending();
+
+protected:
+    void Schedule();
+    void RunOnce();
+
+    WorkerPool* pool;
+    std::mutex mtx;
+    std::condition_variable idleCv;
+    std::deque<PoolTask> tasks;
+    bool active = true;
+    bool scheduled = false;
+};
+
+extern WorkerPool* WORKER_POOL;
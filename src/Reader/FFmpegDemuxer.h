@@ -233,6 +233,13 @@ public:
     int GetFrameSize() {
         return nWidth * (nHeight + nChromaHeight) * nBPP;
     }
+    AVCodecParameters *GetCodecParameters() {
+        return fmtc->streams[iVideoStream]->codecpar;
+    }
+    // Packets were converted to Annex B and no longer match the avcC extradata
+    bool IsAnnexB() {
+        return bMp4H264 || bMp4HEVC;
+    }
     bool Seek(int64_t ptsMs) {
 
         int64_t pts = ptsMs / timeBase / userTimeScale;
@@ -333,21 +340,4 @@ public:
     }
 };
 
-inline cudaVideoCodec FFmpeg2NvCodecId(AVCodecID id) {
-    switch (id) {
-    case AV_CODEC_ID_MPEG1VIDEO : return cudaVideoCodec_MPEG1;
-    case AV_CODEC_ID_MPEG2VIDEO : return cudaVideoCodec_MPEG2;
-    case AV_CODEC_ID_MPEG4      : return cudaVideoCodec_MPEG4;
-    case AV_CODEC_ID_WMV3       :
-    case AV_CODEC_ID_VC1        : return cudaVideoCodec_VC1;
-    case AV_CODEC_ID_H264       : return cudaVideoCodec_H264;
-    case AV_CODEC_ID_HEVC       : return cudaVideoCodec_HEVC;
-    case AV_CODEC_ID_VP8        : return cudaVideoCodec_VP8;
-    case AV_CODEC_ID_VP9        : return cudaVideoCodec_VP9;
-    case AV_CODEC_ID_MJPEG      : return cudaVideoCodec_JPEG;
-    case AV_CODEC_ID_AV1        : return cudaVideoCodec_AV1;
-    default                     : return cudaVideoCodec_NumCodecs;
-    }
-}
-
 
@@ -0,0 +1,157 @@
+#include "VideoReader.h"
+
+#include "Diagnostics/Trace.h"
+
+#include <deque>
+
+using namespace std;
+
+// Serves frames from the seek position towards the start of the video. Decoders only run forward, so
+// the group of pictures before the current position is decoded and its last reverseBufferFrames frames
+// are buffered and handed out in reverse. Earlier frames of a long group are dropped and decoded again
+// for the next chunk, which keeps the memory the same whatever the keyframe interval.
+class ReverseVideoReader : public VideoReader
+{
+public:
+    ReverseVideoReader(cv::Ptr<VideoReader> reader);
+
+    cv::cuda::GpuMat NextFrame(cv::cuda::Stream& stream);
+    cv::Mat NextHostFrame();
+    bool Seek(unsigned long time);
+    unsigned long GetPosition();
+    unsigned long GetDuration();
+    cv::Size GetSize();
+
+protected:
+    bool Fill();
+    DecodedFrame Pop();
+
+    cv::Ptr<VideoReader> reader;
+    std::deque<std::pair<unsigned long, DecodedFrame>> buffer;
+
+    // Frames at or after this time were served already
+    unsigned long end = 0;
+    unsigned long position = 0;
+    bool started = false;
+
+    // Seeking this far back usually lands on the keyframe of the previous group
+    static const unsigned long seekBack = 250;
+};
+
+ReverseVideoReader::ReverseVideoReader(cv::Ptr<VideoReader> reader)
+    :reader(reader)
+{
+
+}
+
+bool ReverseVideoReader::Fill()
+{
+    TRACE_SCOPE("reverse fill");
+
+    buffer.clear();
+    if (!started || end == 0)
+        return false;
+
+    unsigned long step = seekBack;
+
+    while (true)
+    {
+        unsigned long from = end > step ? end - step : 0;
+        reader->Seek(from);
+
+        // The demuxer lands on the keyframe before from, decode up to the frames already served
+        while (true)
+        {
+            DecodedFrame frame;
+            try {
+                frame = reader->NextDecoded();
+            }
+            catch (...) {
+                break;
+            }
+
+            unsigned long time = reader->GetPosition();
+            if (time >= end)
+                break;
+
+            buffer.emplace_back(time, frame);
+            if (buffer.size() > (size_t)reverseBufferFrames)
+                buffer.pop_front();
+        }
+
+        if (!buffer.empty() || from == 0)
+            break;
+
+        // The keyframe was not before the frames already served, reach further back
+        step *= 2;
+    }
+
+    if (buffer.empty())
+        return false;
+
+    end = buffer.front().first;
+    return true;
+}
+
+DecodedFrame ReverseVideoReader::Pop()
+{
+    if (buffer.empty() && !Fill())
+        throw "Reading failed";
+
+    auto f = buffer.back();
+    buffer.pop_back();
+
+    position = f.first;
+    return f.second;
+}
+
+cv::cuda::GpuMat ReverseVideoReader::NextFrame(cv::cuda::Stream& stream)
+{
+#ifdef WITH_CUDA
+    return Pop();
+#else
+    cv::cuda::GpuMat out;
+    out.upload(Pop(), stream);
+    return out;
+#endif
+}
+
+cv::Mat ReverseVideoReader::NextHostFrame()
+{
+#ifdef WITH_CUDA
+    cv::Mat out;
+    Pop().download(out);
+    return out;
+#else
+    return Pop();
+#endif
+}
+
+bool ReverseVideoReader::Seek(unsigned long time)
+{
+    // The frame at time is the first one served
+    buffer.clear();
+    end = time + 1;
+    started = true;
+    return true;
+}
+
+unsigned long ReverseVideoReader::GetPosition()
+{
+    return position;
+}
+
+unsigned long ReverseVideoReader::GetDuration()
+{
+    return reader->GetDuration();
+}
+
+cv::Size ReverseVideoReader::GetSize()
+{
+    return reader->GetSize();
+}
+
+cv::Ptr<VideoReader> VideoReader::createReverse(cv::Ptr<VideoReader> reader)
+{
+    return cv::makePtr<ReverseVideoReader>(reader);
+}
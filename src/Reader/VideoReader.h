@@ -1,18 +1,60 @@
 #pragma once
 
+#include "Pipeline/ResourcePool.h"
+
 #include <opencv2/core.hpp>
 #include <opencv2/core/cuda.hpp>
 #include <string>
 
+// Frames the runners pass between their stages, in device memory when built with cuda and in host memory without
+#ifdef WITH_CUDA
+typedef cv::cuda::GpuMat DecodedFrame;
+#else
+typedef cv::Mat DecodedFrame;
+#endif
+
 class VideoReader
 {
 public:
     VideoReader() {};
 
     virtual cv::cuda::GpuMat NextFrame(cv::cuda::Stream& stream = cv::cuda::Stream::Null()) = 0;
+    // BGRA frame in host memory
+    virtual cv::Mat NextHostFrame()
+    {
+        cv::Mat out;
+        NextFrame().download(out);
+        return out;
+    }
+    // Next frame in the memory the runners work in
+    DecodedFrame NextDecoded()
+    {
+#ifdef WITH_CUDA
+        return NextFrame();
+#else
+        return NextHostFrame();
+#endif
+    }
     virtual bool Seek(unsigned long time) = 0;
     virtual unsigned long GetPosition() = 0;
     virtual unsigned long GetDuration() = 0;
+    virtual cv::Size GetSize() = 0;
 
+    // Nvdec reader when built with cuda, the cpu one otherwise
     static cv::Ptr<VideoReader> create(std::string fileName);
-};
\ No newline at end of file
+#ifdef WITH_CUDA
+    static cv::Ptr<VideoReader> createNvdec(std::string fileName);
+#endif
+    // Like create, but takes an idle reader of the same file from READER_POOL when there is one. Seek before reading
+    static cv::Ptr<VideoReader> open(std::string fileName);
+    // Decodes with libavcodec, works without a cuda device as long as only host frames are read
+    static cv::Ptr<VideoReader> createCpu(std::string fileName);
+    // Reads backwards from the position given to Seek, at most reverseBufferFrames frames per decode from a keyframe
+    static cv::Ptr<VideoReader> createReverse(cv::Ptr<VideoReader> reader);
+
+    // Frames a reverse reader holds at most, longer groups of pictures are decoded again for every chunk
+    static const int reverseBufferFrames = 64;
+};
+
+// Decoders of finished runners, only kept once a capacity is set, see JobServer
+extern ResourcePool<VideoReader>* READER_POOL;
@@ -0,0 +1,178 @@
+#include "VideoReader.h"
+
+#include "FFmpegDemuxer.h"
+#include "Diagnostics/Metrics.h"
+#include "Diagnostics/Trace.h"
+
+#include <opencv2/imgproc.hpp>
+
+extern "C" {
+#include <libavutil/imgutils.h>
+}
+
+using namespace std;
+
+// Software decoding on the calling thread, same demuxer and timestamps as the nvdec reader
+class VideoReaderCpu : public VideoReader
+{
+public:
+    VideoReaderCpu(std::string fileName);
+    ~VideoReaderCpu();
+
+    cv::cuda::GpuMat NextFrame(cv::cuda::Stream& stream);
+    cv::Mat NextHostFrame();
+    bool Seek(unsigned long time);
+    unsigned long GetPosition();
+    unsigned long GetDuration();
+    cv::Size GetSize();
+
+protected:
+    bool ReceiveFrame(cv::Mat& out);
+
+    FFmpegDemuxer demuxer;
+    AVCodecContext* ctx = nullptr;
+    AVFrame* frame = nullptr;
+    AVPacket* packet = nullptr;
+
+    mutex decMtx;
+    int64_t lastPts = 0;
+    bool flushed = false;
+};
+
+VideoReaderCpu::VideoReaderCpu(std::string fileName)
+    :demuxer(fileName.c_str())
+{
+    const AVCodec* codec = avcodec_find_decoder(demuxer.GetVideoCodec());
+    if (!codec)
+        throw "No decoder";
+
+    ctx = avcodec_alloc_context3(codec);
+    avcodec_parameters_to_context(ctx, demuxer.GetCodecParameters());
+
+    if (demuxer.IsAnnexB() && ctx->extradata)
+    {
+        av_freep(&ctx->extradata);
+        ctx->extradata_size = 0;
+    }
+
+    if (avcodec_open2(ctx, codec, nullptr) < 0)
+        throw "Opening decoder failed";
+
+    frame = av_frame_alloc();
+    packet = av_packet_alloc();
+}
+
+VideoReaderCpu::~VideoReaderCpu()
+{
+    av_packet_free(&packet);
+    av_frame_free(&frame);
+    avcodec_free_context(&ctx);
+}
+
+bool VideoReaderCpu::ReceiveFrame(cv::Mat& out)
+{
+    if (avcodec_receive_frame(ctx, frame) < 0)
+        return false;
+
+    lastPts = frame->best_effort_timestamp;
+
+    AVPixelFormat format = (AVPixelFormat)frame->format;
+    if (format != AV_PIX_FMT_YUV420P && format != AV_PIX_FMT_YUVJ420P)
+        throw "Unsupported pixel format";
+
+    // Pack the planes without padding, the layout cvtColor expects for I420
+    int w = frame->width, h = frame->height;
+    cv::Mat yuv(h + h / 2, w, CV_8UC1);
+    av_image_copy_to_buffer(yuv.data, (int)yuv.total(), frame->data, frame->linesize, format, w, h, 1);
+
+    cv::cvtColor(yuv, out, cv::COLOR_YUV2BGRA_I420);
+    av_frame_unref(frame);
+    return true;
+}
+
+cv::Mat VideoReaderCpu::NextHostFrame()
+{
+    static LatencyHistogram& demuxLatency = METRICS->Histogram("demux");
+    static LatencyHistogram& decodeLatency = METRICS->Histogram("decode");
+
+    TRACE_SCOPE("next frame");
+    auto lock = TraceLock(decMtx, "decMtx");
+
+    cv::Mat out;
+
+    while (true)
+    {
+        {
+            ScopedLatency t(decodeLatency);
+            if (ReceiveFrame(out))
+                return out;
+        }
+
+        if (flushed)
+            throw "Reading failed";
+
+        uint8_t* data = nullptr;
+        int bytes = 0;
+        int64_t pts = 0;
+
+        bool ok;
+        {
+            ScopedLatency t(demuxLatency);
+            ok = demuxer.Demux(&data, &bytes, &pts);
+        }
+
+        ScopedLatency t(decodeLatency);
+
+        if (!ok || bytes == 0)
+        {
+            // Drain the frames still held by the decoder
+            avcodec_send_packet(ctx, nullptr);
+            flushed = true;
+            continue;
+        }
+
+        packet->data = data;
+        packet->size = bytes;
+        packet->pts = pts;
+        packet->dts = pts;
+
+        avcodec_send_packet(ctx, packet);
+    }
+}
+
+cv::cuda::GpuMat VideoReaderCpu::NextFrame(cv::cuda::Stream& stream)
+{
+    cv::cuda::GpuMat out;
+    out.upload(NextHostFrame(), stream);
+    return out;
+}
+
+bool VideoReaderCpu::Seek(unsigned long time)
+{
+    auto lock = TraceLock(decMtx, "decMtx");
+
+    avcodec_flush_buffers(ctx);
+    flushed = false;
+
+    return demuxer.Seek(time);
+}
+
+unsigned long VideoReaderCpu::GetPosition()
+{
+    return lastPts;
+}
+
+unsigned long VideoReaderCpu::GetDuration()
+{
+    return demuxer.GetDuration();
+}
+
+cv::Size VideoReaderCpu::GetSize()
+{
+    return cv::Size(demuxer.GetWidth(), demuxer.GetHeight());
+}
+
+cv::Ptr<VideoReader> VideoReader::createCpu(std::string fileName)
+{
+    return cv::makePtr<VideoReaderCpu>(fileName);
+}
@@ -0,0 +1,197 @@
+#include "VideoReader.h"
+
+#include "NvDecoder.h"
+#include "NvCodecUtils.h"
+#include "FFmpegDemuxer.h"
+#include "Logger.h"
+#include "Diagnostics/Metrics.h"
+#include "Diagnostics/Trace.h"
+
+#include <driver_types.h>
+#include <cuda.h>
+#include <opencv2/core/cuda_stream_accessor.hpp>
+#include <chrono>
+
+using namespace std;
+using namespace chrono;
+
+#if !WIN32
+#ifndef high_resolution_clock
+#define high_resolution_clock steady_clock
+#endif
+#endif
+
+// Lives here instead of FFmpegDemuxer.h so the cpu reader builds without the nvdec headers
+static cudaVideoCodec FFmpeg2NvCodecId(AVCodecID id) {
+    switch (id) {
+    case AV_CODEC_ID_MPEG1VIDEO : return cudaVideoCodec_MPEG1;
+    case AV_CODEC_ID_MPEG2VIDEO : return cudaVideoCodec_MPEG2;
+    case AV_CODEC_ID_MPEG4      : return cudaVideoCodec_MPEG4;
+    case AV_CODEC_ID_WMV3       :
+    case AV_CODEC_ID_VC1        : return cudaVideoCodec_VC1;
+    case AV_CODEC_ID_H264       : return cudaVideoCodec_H264;
+    case AV_CODEC_ID_HEVC       : return cudaVideoCodec_HEVC;
+    case AV_CODEC_ID_VP8        : return cudaVideoCodec_VP8;
+    case AV_CODEC_ID_VP9        : return cudaVideoCodec_VP9;
+    case AV_CODEC_ID_MJPEG      : return cudaVideoCodec_JPEG;
+    case AV_CODEC_ID_AV1        : return cudaVideoCodec_AV1;
+    default                     : return cudaVideoCodec_NumCodecs;
+    }
+}
+
+class VideoReaderImp : public VideoReader
+{
+public:
+    VideoReaderImp(std::string fileName);
+    ~VideoReaderImp();
+
+    cv::cuda::GpuMat NextFrame(cv::cuda::Stream& stream);
+    bool Seek(unsigned long time);
+    unsigned long GetPosition();
+    unsigned long GetDuration();
+    cv::Size GetSize();
+    void RunThread();
+
+protected:
+    string fileName;
+    FFmpegDemuxer demuxer;
+    
+    mutex decMtx;
+    NvDecoder* dec;
+
+    int64_t lastPts;
+    thread readThread;
+    bool running = false;
+    bool err = false;
+};
+
+VideoReaderImp::VideoReaderImp(std::string fileName)
+    :fileName(fileName), demuxer(fileName.c_str())
+{
+    // init context
+    cv::cuda::GpuMat temp(1, 1, CV_8UC1);
+    temp.release();
+
+    Rect cropRect = {};
+    Dim resizeDim = {};
+
+    dec = new NvDecoder(true, FFmpeg2NvCodecId(demuxer.GetVideoCodec()));
+    dec->SetOperatingPoint(0, false);
+}
+
+VideoReaderImp::~VideoReaderImp()
+{
+    running = false;
+    if (readThread.joinable())
+        readThread.join();
+
+    delete dec;
+}
+
+void VideoReaderImp::RunThread()
+{
+    static LatencyHistogram& demuxLatency = METRICS->Histogram("demux");
+    static LatencyHistogram& decodeLatency = METRICS->Histogram("decode");
+    Tracer::SetThreadName("reader");
+
+    while (running)
+    {
+        int nVideoBytes = 0, nFrameReturned = 0;
+        int64_t pts = 0;
+
+        uint8_t* pVideo = NULL;
+        int tries = 0;
+
+        while (tries < 10)
+        {
+            {
+                auto lock = TraceLock(decMtx, "decMtx");
+                {
+                    TRACE_SCOPE("demux");
+                    ScopedLatency t(demuxLatency);
+                    demuxer.Demux(&pVideo, &nVideoBytes, &pts);
+                }
+                {
+                    TRACE_SCOPE("decode");
+                    ScopedLatency t(decodeLatency);
+                    nFrameReturned = dec->Decode(pVideo, nVideoBytes, 0, pts);
+                }
+            }
+
+            if (nFrameReturned)
+            {
+                break;
+            }
+
+            tries++;
+        }
+
+        if (nFrameReturned == 0)
+        {
+            err = true;
+            running = false;
+        }
+
+        if (dec->NumFrames() > 60)
+            running = false;
+
+    }
+}
+
+cv::cuda::GpuMat VideoReaderImp::NextFrame(cv::cuda::Stream& stream)
+{
+    TRACE_SCOPE("next frame");
+
+    if (dec->NumFrames() < 30)
+    {
+        if (!running)
+        {
+            if (readThread.joinable())
+                readThread.join();
+
+            running = true;
+            readThread = std::thread(&VideoReaderImp::RunThread, this);
+        }
+    }
+
+    auto now = steady_clock::now();
+
+    do {
+        if (dec->NumFrames() > 0)
+        {
+            auto lock = TraceLock(decMtx, "decMtx");
+            return dec->GetFrame(&lastPts);
+        }
+    } while (duration_cast<chrono::milliseconds>(high_resolution_clock::now() - now).count() < 1000);
+
+    throw "Reading failed";
+}
+
+bool VideoReaderImp::Seek(unsigned long time)
+{
+    auto lock = TraceLock(decMtx, "decMtx");
+
+    dec->Flush();
+
+    return demuxer.Seek(time);
+}
+
+unsigned long VideoReaderImp::GetPosition()
+{
+    return lastPts;
+}
+
+unsigned long VideoReaderImp::GetDuration()
+{
+    return demuxer.GetDuration();
+}
+
+cv::Size VideoReaderImp::GetSize()
+{
+    return cv::Size(demuxer.GetWidth(), demuxer.GetHeight());
+}
+
+cv::Ptr<VideoReader> VideoReader::createNvdec(std::string fileName)
+{
+    return cv::makePtr<VideoReaderImp>(fileName);
+}
@@ -2,6 +2,7 @@
 #include "StateEditRange.h"
 #include "States/Target/StateEditTarget.h"
 #include "States/Tracking/StateTracking.h"
+#include "States/StateSelectRoi.h"
 //#include "States/Tracking/StateTrackingThreaded.h"
 #include "Gui/TrackingWindow.h"
 #include "Gui/GuiButtonExpand.h"
@@ -17,9 +18,10 @@ using namespace OIS;
 // StateEditSet
 
 StateEditSet::StateEditSet(TrackingWindow* window, TrackingSetPtr set)
-	:StatePlayerImpl(window), set(set), runner(window, set, nullptr, true, false, true)
+	:StatePlayerImpl(window), set(set), runner(window, set, nullptr, true, false)
 {
-
+	// The preview drops tracking resolution on large sources instead of falling behind
+	runner.SetQos(previewFps);
 }
 
 void StateEditSet::Update()
@@ -76,8 +78,14 @@ void StateEditSet::SetPreview(bool b)
 
 	if (b)
 	{
+		// Only the results from the current frame on are tracked again when there are checkpoints before it
+		runner.SetResume(window->GetCurrentPosition());
 		runner.Setup();
 	}
+	else
+	{
+		runner.SetRunning(false);
+	}
 
 	updatePreview = b;
 }
@@ -205,6 +213,26 @@ void StateEditSet::UpdateButtons(ButtonListOut out)
 			r
 				);
 
+		r = Rect(
+			r.x + r.width + 10,
+			y,
+			40,
+			40
+		);
+
+		// Correct the target on this frame
+		b = &AddButton(
+			out,
+			"A",
+			[me, t](auto w) {
+				me->Reanchor(t);
+			},
+			r
+				);
+
+		if (t->anchors.count(window->GetCurrentPosition()))
+			b->textColor = t->color;
+
 		y += (40 + 20);
 	}
 
@@ -242,6 +270,38 @@ void StateEditSet::UpdateButtons(ButtonListOut out)
 	);
 }
 
+void StateEditSet::Reanchor(TrackingTarget* t)
+{
+	time_t time = window->GetCurrentPosition();
+	if (time == set->timeStart)
+	{
+		window->PushState(new StateEditTarget(window, set, t));
+		return;
+	}
+
+	// The preview must not read the anchors while they change, it starts again from the anchor afterwards
+	bool preview = updatePreview;
+	SetPreview(false);
+
+	auto me = this;
+	window->PushState(new StateSelectRoi(window, "Select the target on this frame (cancel to remove the correction)",
+		[me, t, time, preview](Rect& rect)
+		{
+			me->set->Reanchor(*t, time, rect);
+			me->SetPreview(preview);
+		},
+		// Failed
+			[me, t, time, preview]()
+		{
+			// Only a correction that exists is removed, cancelling on any other frame keeps the results
+			if (t->anchors.count(time) > 0)
+				me->set->Reanchor(*t, time, Rect());
+
+			me->SetPreview(preview);
+		}
+		));
+}
+
 void StateEditSet::CopySet()
 {
 	TrackingSetPtr s = window->AddSet();
@@ -271,6 +331,7 @@ void StateEditSet::CopySet()
 			}
 
 			newTarget.preferredTracker = t.preferredTracker;
+			newTarget.coarseToFine = t.coarseToFine;
 			newTarget.range = t.range;
 			newTarget.targetType = t.targetType;
 			newTarget.trackingType = t.trackingType;
@@ -23,9 +23,13 @@ public:
 protected:
 	void CopySet();
 	void SetPreview(bool b);
+	// Records a corrected box for the target at the current frame, tracking continues from there
+	void Reanchor(TrackingTarget* t);
 
 	TrackingRunner runner;
 	TrackingSetPtr set;
 	bool modeOpen = false;
 	bool updatePreview = false;
+
+	static constexpr double previewFps = 30;
 };
\ No newline at end of file
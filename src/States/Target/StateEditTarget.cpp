@@ -6,6 +6,7 @@
 #include "Gui/GuiButtonExpand.h"
 #include "Gui/TrackingWindow.h"
 #include "Tracking/Trackers.h"
+#include "Batch/TrackerProbe.h"
 
 #include <opencv2/cudaimgproc.hpp>
 #include <opencv2/imgproc.hpp>
@@ -67,6 +68,32 @@ void StateEditTarget::UpdateButtons(ButtonListOut out)
 			));
 	}, KC_G);
 
+	// End anchor at the current frame, the set is then tracked from both ends
+	AddButton(out, target->HasEnd() ? "End anchor (Y)" : "End anchor (N)", [me](auto w) {
+		time_t time = w->GetCurrentPosition();
+
+		w->PushState(new StateSelectRoi(me->window, "Select the target at the end of the set (cancel to remove)",
+			[me, time](Rect& rect)
+			{
+				// All targets share one anchor time
+				if (me->set->anchorEnd != time)
+				{
+					for (auto& t : me->set->targets)
+						t.endRect = Rect();
+
+					me->set->anchorEnd = time;
+				}
+
+				me->target->endRect = rect;
+			},
+			// Failed
+				[me]()
+			{
+				me->target->endRect = Rect();
+			}
+			));
+	});
+
 
 	GuiButtonExpand* trackerBtn = new GuiButtonExpand(GuiButton::Next(out), "Tracker: " + GetTracker(target->preferredTracker).name);
 	for (auto& t : magic_enum::enum_entries<TrackerJTType>())
@@ -77,6 +104,7 @@ void StateEditTarget::UpdateButtons(ButtonListOut out)
 
 		auto& b = trackerBtn->AddButton(new GuiButton(trackerBtn->Next(), [me, t]() {
 			me->target->preferredTracker = t.first;
+			me->target->trackerScores.clear();
 			me->trackerOpen = false;
 			me->window->DrawWindow(true);
 		}, s.name));
@@ -84,6 +112,22 @@ void StateEditTarget::UpdateButtons(ButtonListOut out)
 
 	out.emplace_back(trackerBtn);
 
+	// Measures the trackers on the first frames of the set and picks the cheapest good one
+	AddButton(out, "Auto tracker", [me](auto w) {
+		TrackerProbe probe(w->project.video);
+		if (probe.Run(me->set, *me->target))
+			probe.PrintScores(*me->target);
+
+		w->DrawWindow(true);
+	});
+
+	string coarseText = "Coarse to fine (";
+	coarseText.append(target->coarseToFine ? "Y" : "N");
+	coarseText.append(")");
+	AddButton(out, coarseText, [me](auto w) {
+		me->target->coarseToFine = !me->target->coarseToFine;
+		w->DrawWindow(true);
+	});
 
 	GuiButtonExpand* typeBtn = new GuiButtonExpand(GuiButton::Next(out), "Type: " + TargetTypeToString(target->targetType));
 	for (auto& t : magic_enum::enum_entries<TARGET_TYPE>())
@@ -10,13 +10,16 @@ using namespace std;
 using namespace chrono;
 
 StateTestTrackers::StateTestTrackers(TrackingWindow* window, TrackingSetPtr set, TrackingTarget* target)
-	:StatePlayer(window), set(set), target(target), runner(window, set, target, false, true, false)
+	:StatePlayer(window), set(set), target(target), runner(window, set, target, false, true)
 {
 
 }
 
 void StateTestTrackers::Update()
 {
+	if (runner.TakePreview())
+		AskDraw();
+
 	if (!playing)
 		return;
 
@@ -24,7 +27,6 @@ void StateTestTrackers::Update()
 	if (state.framesRdy > 0)
 	{
 		UpdateFPS(state.framesRdy);
-		AskDraw();
 		runner.GetState(true);
 	}
 
@@ -47,6 +49,7 @@ void StateTestTrackers::UpdateButtons(ButtonListOut out)
 
 			GuiButton& btn = AddButton(out, "Pick " + b->trackerStruct.name, [me, t](auto w) {
 				me->target->preferredTracker = t;
+				me->target->trackerScores.clear();
 				me->Pop();
 			});
 
@@ -81,6 +84,7 @@ void StateTestTrackers::SetPlaying(bool b)
 void StateTestTrackers::NextFrame()
 {
 	runner.Update(true);
+	runner.TakePreview();
 	AskDraw();
 }
 
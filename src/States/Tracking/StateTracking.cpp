@@ -13,9 +13,9 @@ using namespace chrono;
 using namespace OIS;
 
 StateTracking::StateTracking(TrackingWindow* window, TrackingSetPtr set)
-	:StatePlayer(window), set(set), runner(window, set, nullptr, true, false, false)
+	:StatePlayer(window), set(set), runner(window, set, nullptr, true, false)
 {
-
+	runner.SetLiveOutput(window->liveOutput);
 }
 
 void StateTracking::EnterState(bool again)
@@ -24,6 +24,9 @@ void StateTracking::EnterState(bool again)
 
 	if (!again)
 	{
+		// Tracking again from a frame inside the tracked part keeps the results up to there
+		runner.SetResume(window->GetCurrentPosition());
+
 		if (!runner.Setup())
 		{
 			Pop();
@@ -119,6 +122,10 @@ void StateTracking::Draw(Mat& frame)
 
 void StateTracking::Update()
 {
+	// Redraws follow the preview rate, not the tracked frames
+	if (runner.TakePreview())
+		AskDraw();
+
 	if (!playing)
 		return;
 
@@ -126,7 +133,6 @@ void StateTracking::Update()
 	if (state.framesRdy > 3)
 	{
 		UpdateFPS(state.framesRdy);
-		AskDraw();
 		runner.GetState(true);
 	}
 
@@ -138,5 +144,6 @@ void StateTracking::Update()
 void StateTracking::NextFrame()
 {
 	runner.Update(true);
+	runner.TakePreview();
 	AskDraw();
 }
\ No newline at end of file
@@ -1,12 +1,30 @@
 #include "FrameCache.h"
+#include "Diagnostics/Metrics.h"
+#include "Diagnostics/Trace.h"
 
+#include <opencv2/imgproc.hpp>
+#ifdef WITH_CUDA
 #include <opencv2/cudaimgproc.hpp>
+#include <opencv2/cudawarping.hpp>
+#endif
 
 using namespace cv;
 using namespace std;
 
 FrameCache* FRAME_CACHE = new FrameCache();
 
+static atomic<int64_t>& CacheHits()
+{
+    static atomic<int64_t>& hits = METRICS->Counter("cache.hits");
+    return hits;
+}
+
+static atomic<int64_t>& CacheMisses()
+{
+    static atomic<int64_t>& misses = METRICS->Counter("cache.misses");
+    return misses;
+}
+
 bool FrameCache::IsCpu(FrameVariant v)
 {
     switch (v)
@@ -19,39 +37,58 @@ bool FrameCache::IsCpu(FrameVariant v)
     }
 }
 
-deque<FrameCache::CacheRecord>::iterator FrameCache::FindCache(cv::cuda::GpuMat frame, FrameVariant v)
+void FrameCache::Reserve(int records)
 {
-    auto cudaPtr = frame.ptr<uint>();
+    auto lock = TraceLock(cacheMtx, "cacheMtx");
+    reserved = max(0, reserved + records);
+    capacity = 10 + reserved;
+}
 
-    auto found = find_if(cache.begin(), cache.end(), [cudaPtr, v](auto& c) {
-        return c.cudaPtr == cudaPtr && c.variant == v;
+deque<FrameCache::CacheRecord>::iterator FrameCache::FindCache(uint* ptr, FrameVariant v, float scale)
+{
+    auto found = find_if(cache.begin(), cache.end(), [ptr, v, scale](auto& c) {
+        return c.cudaPtr == ptr && c.variant == v && c.scale == scale;
     });
 
     return found;
 }
 
-Mat FrameCache::CpuVariant(cv::cuda::GpuMat from, FrameVariant to, cv::cuda::Stream& stream)
+Mat FrameCache::CpuVariant(cv::cuda::GpuMat from, FrameVariant to, cv::cuda::Stream& stream, float scale)
 {
+    static LatencyHistogram& downloadLatency = METRICS->Histogram("convert.download");
+
     {
-        lock_guard<mutex> lock(cacheMtx);
+        auto lock = TraceLock(cacheMtx, "cacheMtx");
 
-        auto f = FindCache(from, to);
+        auto f = FindCache(from.ptr<uint>(), to, scale);
         if (f != cache.end())
+        {
+            CacheHits()++;
             return f->GetCpu();
+        }
     }
 
+    CacheMisses()++;
 
-    CacheRecord r(true, from.ptr<uint>(), to);
+    CacheRecord r(true, from, to, scale);
     cuda::GpuMat buffer;
 
     switch (to) {
     case FrameVariant::LOCAL_RGB:
-        buffer = GpuVariant(from, FrameVariant::GPU_RGB, stream);
-        buffer.download(r.cpuFrame);
+        buffer = GpuVariant(from, FrameVariant::GPU_RGB, stream, scale);
+        {
+            TRACE_SCOPE("download");
+            ScopedLatency t(downloadLatency);
+            buffer.download(r.cpuFrame);
+        }
         break;
     case FrameVariant::LOCAL_GREY:
-        buffer = GpuVariant(from, FrameVariant::GPU_GREY, stream);
-        buffer.download(r.cpuFrame);
+        buffer = GpuVariant(from, FrameVariant::GPU_GREY, stream, scale);
+        {
+            TRACE_SCOPE("download");
+            ScopedLatency t(downloadLatency);
+            buffer.download(r.cpuFrame);
+        }
         break;
     default:
         throw "Failed";
@@ -61,30 +98,122 @@ Mat FrameCache::CpuVariant(cv::cuda::GpuMat from, FrameVariant to, cv::cuda::Str
     return r.GetCpu();
 }
 
-cuda::GpuMat FrameCache::GpuVariant(cv::cuda::GpuMat from, FrameVariant to, cv::cuda::Stream& stream)
+FrameVariant FrameCache::LocalVariant(FrameVariant v)
+{
+    switch (v)
+    {
+    case GPU_GREY:
+        return LOCAL_GREY;
+    case GPU_RGB:
+        return LOCAL_RGB;
+    default:
+        return v;
+    }
+}
+
+Mat FrameCache::CpuVariant(Mat from, FrameVariant to, float scale)
+{
+    static LatencyHistogram& rgbLatency = METRICS->Histogram("convert.cpu_rgb");
+    static LatencyHistogram& greyLatency = METRICS->Histogram("convert.cpu_grey");
+    static LatencyHistogram& resizeLatency = METRICS->Histogram("convert.resize");
+
+    to = LocalVariant(to);
+    if (to == GPU_RGBA && scale == 1)
+        return from;
+
+    {
+        auto lock = TraceLock(cacheMtx, "cacheMtx");
+
+        auto f = FindCache(from.ptr<uint>(), to, scale);
+        if (f != cache.end())
+        {
+            CacheHits()++;
+            return f->GetCpu();
+        }
+    }
+
+    CacheMisses()++;
+
+    CacheRecord r(from, to, scale);
+
+    if (to == GPU_RGBA)
+    {
+        TRACE_SCOPE("resize");
+        ScopedLatency t(resizeLatency);
+        resize(from, r.cpuFrame, ScaledSize(from.size(), scale), 0, 0, INTER_AREA);
+    }
+    else
+    {
+        // Shrink before converting like the gpu variants
+        Mat source = scale != 1 ? CpuVariant(from, GPU_RGBA, scale) : from;
+
+        switch (to) {
+        case FrameVariant::LOCAL_RGB:
+        {
+            TRACE_SCOPE("convert rgb");
+            ScopedLatency t(rgbLatency);
+            cvtColor(source, r.cpuFrame, COLOR_BGRA2BGR);
+            break;
+        }
+        case FrameVariant::LOCAL_GREY:
+        {
+            TRACE_SCOPE("convert grey");
+            ScopedLatency t(greyLatency);
+            cvtColor(source, r.cpuFrame, COLOR_BGRA2GRAY);
+            break;
+        }
+        default:
+            throw "Failed";
+        }
+    }
+
+    Store(r);
+    return r.GetCpu();
+}
+
+#ifdef WITH_CUDA
+cuda::GpuMat FrameCache::GpuVariant(cv::cuda::GpuMat from, FrameVariant to, cv::cuda::Stream& stream, float scale)
 {
+    static LatencyHistogram& rgbLatency = METRICS->Histogram("convert.gpu_rgb");
+    static LatencyHistogram& greyLatency = METRICS->Histogram("convert.gpu_grey");
+
+    if (scale != 1)
+        return ScaledVariant(from, to, stream, scale);
+
     if (to == GPU_RGBA)
         return from;
 
     {
-        lock_guard<mutex> lock(cacheMtx);
+        auto lock = TraceLock(cacheMtx, "cacheMtx");
 
-        auto f = FindCache(from, to);
+        auto f = FindCache(from.ptr<uint>(), to);
         if (f != cache.end())
+        {
+            CacheHits()++;
             return f->GetGpu();
+        }
     }
 
+    CacheMisses()++;
 
-    CacheRecord r(false, from.ptr<uint>(), to);
+    CacheRecord r(false, from, to);
     cuda::GpuMat buffer;
 
     switch (to) {
     case FrameVariant::GPU_RGB:
+    {
+        TRACE_SCOPE("convert rgb");
+        ScopedLatency t(rgbLatency);
         cuda::cvtColor(from, r.gpuFrame, COLOR_BGRA2BGR, 0, stream);
         break;
+    }
     case FrameVariant::GPU_GREY:
+    {
+        TRACE_SCOPE("convert grey");
+        ScopedLatency t(greyLatency);
         cuda::cvtColor(from, r.gpuFrame, COLOR_BGRA2GRAY, 0, stream);
         break;
+    }
     default:
         throw "Failed";
     }
@@ -93,12 +222,71 @@ cuda::GpuMat FrameCache::GpuVariant(cv::cuda::GpuMat from, FrameVariant to, cv::
     return r.GetGpu();
 }
 
+cuda::GpuMat FrameCache::ScaledVariant(cv::cuda::GpuMat from, FrameVariant to, cv::cuda::Stream& stream, float scale)
+{
+    static LatencyHistogram& resizeLatency = METRICS->Histogram("convert.resize");
+
+    {
+        auto lock = TraceLock(cacheMtx, "cacheMtx");
+
+        auto f = FindCache(from.ptr<uint>(), to, scale);
+        if (f != cache.end())
+        {
+            CacheHits()++;
+            return f->GetGpu();
+        }
+    }
+
+    CacheMisses()++;
+
+    CacheRecord r(false, from, to, scale);
+
+    if (to == GPU_RGBA)
+    {
+        // Shrink before converting so the colour conversion runs on the small frame
+        TRACE_SCOPE("resize");
+        ScopedLatency t(resizeLatency);
+        cuda::resize(from, r.gpuFrame, ScaledSize(from.size(), scale), 0, 0, INTER_AREA, stream);
+    }
+    else
+    {
+        cuda::GpuMat small = ScaledVariant(from, GPU_RGBA, stream, scale);
+
+        switch (to) {
+        case FrameVariant::GPU_RGB:
+            cuda::cvtColor(small, r.gpuFrame, COLOR_BGRA2BGR, 0, stream);
+            break;
+        case FrameVariant::GPU_GREY:
+            cuda::cvtColor(small, r.gpuFrame, COLOR_BGRA2GRAY, 0, stream);
+            break;
+        default:
+            throw "Failed";
+        }
+    }
+
+    Store(r);
+    return r.GetGpu();
+}
+
+#else
+// Nothing is decoded into device memory without cuda
+cuda::GpuMat FrameCache::GpuVariant(cv::cuda::GpuMat from, FrameVariant to, cv::cuda::Stream& stream, float scale)
+{
+    throw "Built without cuda";
+}
+
+cuda::GpuMat FrameCache::ScaledVariant(cv::cuda::GpuMat from, FrameVariant to, cv::cuda::Stream& stream, float scale)
+{
+    throw "Built without cuda";
+}
+#endif
+
 void FrameCache::Store(CacheRecord& r)
 {
-    lock_guard<mutex> lock(cacheMtx);
+    auto lock = TraceLock(cacheMtx, "cacheMtx");
     cache.push_front(r);
     
-    if (cache.size() > 10)
+    while (cache.size() > capacity)
     {
         cache.pop_back();
     }
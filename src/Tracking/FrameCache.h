@@ -10,26 +10,46 @@ class FrameCache
 {
 public:
     // From should always be FrameVariant::GPU_RGBA !
+    // A scale below 1 gives the variant at a lower resolution, shared by every tracker working at that scale
 
-    cv::Mat CpuVariant(cv::cuda::GpuMat from, FrameVariant to, cv::cuda::Stream& stream = cv::cuda::Stream::Null());
-    cv::cuda::GpuMat GpuVariant(cv::cuda::GpuMat from, FrameVariant to, cv::cuda::Stream& stream = cv::cuda::Stream::Null());
+    cv::Mat CpuVariant(cv::cuda::GpuMat from, FrameVariant to, cv::cuda::Stream& stream = cv::cuda::Stream::Null(), float scale = 1);
+    cv::cuda::GpuMat GpuVariant(cv::cuda::GpuMat from, FrameVariant to, cv::cuda::Stream& stream = cv::cuda::Stream::Null(), float scale = 1);
+    // Same for frames decoded into host memory, a gpu variant gives the local one with the same pixels
+    cv::Mat CpuVariant(cv::Mat from, FrameVariant to, float scale = 1);
+    static FrameVariant LocalVariant(FrameVariant v);
 
     bool IsCpu(FrameVariant v);
+    static cv::Size ScaledSize(cv::Size size, float scale)
+    {
+        return cv::Size(cvRound(size.width * scale), cvRound(size.height * scale));
+    };
+    // Runners add room for the variants of their frames in flight and give it back when done
+    void Reserve(int records);
 
 protected:
     struct CacheRecord
     {
-        CacheRecord(bool isCpu, uint *cudaPtr, FrameVariant variant)
-            :isCpu(isCpu), cudaPtr(cudaPtr), variant(variant)
+        CacheRecord(bool isCpu, cv::cuda::GpuMat source, FrameVariant variant, float scale = 1)
+            :isCpu(isCpu), source(source), cudaPtr(source.ptr<uint>()), variant(variant), scale(scale)
+        {
+        };
+
+        CacheRecord(cv::Mat hostSource, FrameVariant variant, float scale = 1)
+            :isCpu(true), hostSource(hostSource), cudaPtr(hostSource.ptr<uint>()), variant(variant), scale(scale)
         {
         };
 
+        // Holding the source keeps its device memory from being reused by a newer frame while cached
+        cv::cuda::GpuMat source;
+        cv::Mat hostSource;
+        // Device pointer of the source, or its host data for host sources
         uint *cudaPtr;
 
         cv::cuda::GpuMat gpuFrame;
         cv::Mat cpuFrame;
 
         FrameVariant variant;
+        float scale = 1;
         int reads = 0;
 
         bool isCpu = false;
@@ -51,10 +71,13 @@ protected:
 
     void Store(CacheRecord& r);
 
-    std::deque<CacheRecord>::iterator FindCache(cv::cuda::GpuMat frame, FrameVariant v);
+    std::deque<CacheRecord>::iterator FindCache(uint* ptr, FrameVariant v, float scale = 1);
+    cv::cuda::GpuMat ScaledVariant(cv::cuda::GpuMat from, FrameVariant to, cv::cuda::Stream& stream, float scale);
 
     std::mutex cacheMtx;
     std::deque<CacheRecord> cache;
+    size_t capacity = 10;
+    int reserved = 0;
 };
 
 extern FrameCache* FRAME_CACHE;
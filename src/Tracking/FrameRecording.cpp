@@ -0,0 +1,181 @@
+#include "FrameRecording.h"
+#include "FrameCache.h"
+
+#include <opencv2/imgcodecs.hpp>
+#include <magic_enum.hpp>
+#include <cstring>
+
+using namespace std;
+using namespace cv;
+
+static const char magic[4] = { 'J', 'T', 'R', 'C' };
+static const uint32_t version = 1;
+
+template<typename T>
+static void WriteValue(ostream& o, T v)
+{
+    o.write((const char*)&v, sizeof(v));
+}
+
+template<typename T>
+static bool ReadValue(istream& i, T& v)
+{
+    i.read((char*)&v, sizeof(v));
+    return !i.fail();
+}
+
+// FrameRecorder
+
+FrameRecorder::FrameRecorder(string file, TrackingSetPtr set)
+    :out(file, ios::binary)
+{
+    // Only the targets are needed to start the trackers, events are what the replay produces
+    json j;
+    j["time_start"] = set->timeStart;
+    j["time_end"] = set->timeEnd;
+    j["tracking_mode"] = magic_enum::enum_name(set->trackingMode);
+    j["targets"] = json::array();
+
+    for (auto& t : set->targets)
+    {
+        json& target = j["targets"][j["targets"].size()];
+        t.Serialize(target);
+    }
+
+    string header = j.dump();
+
+    out.write(magic, sizeof(magic));
+    WriteValue(out, version);
+    WriteValue(out, (uint32_t)header.size());
+    out.write(header.data(), header.size());
+}
+
+void FrameRecorder::WriteImage(FrameVariant v, Mat& image)
+{
+    vector<uchar> buffer;
+    imencode(".png", image, buffer);
+
+    WriteValue(out, (uint8_t)v);
+    WriteValue(out, (uint32_t)buffer.size());
+    out.write((const char*)buffer.data(), buffer.size());
+}
+
+void FrameRecorder::Write(time_t time, cuda::GpuMat frame, const vector<FrameVariant>& variants)
+{
+    Mat rgba;
+    frame.download(rgba);
+
+    vector<pair<FrameVariant, Mat>> images;
+    images.emplace_back(GPU_RGBA, rgba);
+
+    for (auto v : variants)
+    {
+        if (v == GPU_RGBA)
+            continue;
+
+        if (FRAME_CACHE->IsCpu(v))
+            images.emplace_back(v, FRAME_CACHE->CpuVariant(frame, v));
+        else
+        {
+            // Stored under the local variant, a replay uploads it again for gpu trackers
+            Mat m;
+            FRAME_CACHE->GpuVariant(frame, v).download(m);
+            images.emplace_back(v == GPU_GREY ? LOCAL_GREY : LOCAL_RGB, m);
+        }
+    }
+
+    WriteFrame(time, images);
+}
+
+void FrameRecorder::Write(time_t time, Mat frame, const vector<FrameVariant>& variants)
+{
+    vector<pair<FrameVariant, Mat>> images;
+    images.emplace_back(GPU_RGBA, frame);
+
+    for (auto v : variants)
+    {
+        if (v != GPU_RGBA)
+            images.emplace_back(FrameCache::LocalVariant(v), FRAME_CACHE->CpuVariant(frame, v));
+    }
+
+    WriteFrame(time, images);
+}
+
+void FrameRecorder::WriteFrame(time_t time, vector<pair<FrameVariant, Mat>>& images)
+{
+    lock_guard<mutex> lock(mtx);
+
+    WriteValue(out, (int64_t)time);
+    WriteValue(out, (uint8_t)images.size());
+
+    for (auto& i : images)
+        WriteImage(i.first, i.second);
+
+    frames++;
+}
+
+// FrameReplay
+
+FrameReplay::FrameReplay(string file)
+    :in(file, ios::binary)
+{
+    char m[4];
+    uint32_t v, length;
+
+    in.read(m, sizeof(m));
+    if (in.fail() || memcmp(m, magic, sizeof(magic)) != 0)
+        return;
+
+    if (!ReadValue(in, v) || v != version)
+        return;
+
+    if (!ReadValue(in, length))
+        return;
+
+    string header(length, '\0');
+    in.read(&header[0], length);
+    if (in.fail())
+        return;
+
+    json j = json::parse(header);
+    set = TrackingSet::Unserialize(j);
+    set->events = make_unique<EventList>();
+
+    firstFrame = in.tellg();
+}
+
+void FrameReplay::Rewind()
+{
+    in.clear();
+    in.seekg(firstFrame);
+}
+
+bool FrameReplay::Next(RecordedFrame& out)
+{
+    int64_t time;
+    uint8_t images;
+
+    if (!ReadValue(in, time) || !ReadValue(in, images))
+        return false;
+
+    out.time = time;
+    out.frame.clear();
+
+    for (int i = 0; i < images; i++)
+    {
+        uint8_t variant;
+        uint32_t length;
+
+        if (!ReadValue(in, variant) || !ReadValue(in, length))
+            return false;
+
+        vector<uchar> buffer(length);
+        in.read((char*)buffer.data(), length);
+        if (in.fail())
+            return false;
+
+        out.frame[(FrameVariant)variant] = imdecode(buffer, IMREAD_UNCHANGED);
+    }
+
+    return out.frame.count(GPU_RGBA) > 0;
+}
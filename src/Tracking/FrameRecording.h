@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Trackers.h"
+#include "Model/TrackingSet.h"
+
+#include <opencv2/core/cuda.hpp>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Recording file layout
+//   "JTRC" version, set json length, set json
+//   per frame: time, image count, per image: variant, png length, png
+// Images are stored lossless so a replay feeds trackers the exact pixels they saw live.
+
+struct RecordedFrame
+{
+    time_t time = 0;
+    HostFrame frame;
+};
+
+// Captures the frames and prepared variants of one tracking set
+class FrameRecorder
+{
+public:
+    FrameRecorder(std::string file, TrackingSetPtr set);
+
+    bool IsOpen() { return out.is_open() && !out.fail(); };
+    void Write(time_t time, cv::cuda::GpuMat frame, const std::vector<FrameVariant>& variants);
+    void Write(time_t time, cv::Mat frame, const std::vector<FrameVariant>& variants);
+    int GetFrames() { return frames; };
+
+protected:
+    void WriteFrame(time_t time, std::vector<std::pair<FrameVariant, cv::Mat>>& images);
+    void WriteImage(FrameVariant v, cv::Mat& image);
+
+    std::mutex mtx;
+    std::ofstream out;
+    int frames = 0;
+};
+
+typedef std::shared_ptr<FrameRecorder> FrameRecorderPtr;
+
+class FrameReplay
+{
+public:
+    FrameReplay(std::string file);
+
+    bool IsOpen() { return set != nullptr; };
+    TrackingSetPtr GetSet() { return set; };
+
+    bool Next(RecordedFrame& out);
+    void Rewind();
+
+protected:
+    std::ifstream in;
+    std::streampos firstFrame;
+    TrackingSetPtr set;
+};
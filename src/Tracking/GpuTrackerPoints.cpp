@@ -30,19 +30,25 @@ void GpuTrackerPoints::initGpu(cuda::GpuMat sourceImg)
     points_ = cuda::GpuMat(state.points.size());
     vector<Point2f> points;
 
+    // Init runs again when the working resolution or region changes, only follow the points still tracked
+    pointStates.clear();
+
     for (int p = 0; p < state.points.size(); p++)
     {
-        GpuPointState ps;
-        ps.cudaIndex = p;
-        ps.cudaIndexNew = -1;
+        if (!state.points.at(p).active)
+            continue;
+
         Point2f point = state.points.at(p).point;
         if (!window.empty()) {
             point -= Point2f(window.x, window.y);
 
-            if (point.x > window.width || point.y > window.height)
+            if (point.x < 0 || point.y < 0 || point.x > window.width || point.y > window.height)
                 continue;
         }
 
+        GpuPointState ps;
+        ps.cudaIndex = points.size();
+        ps.cudaIndexNew = -1;
 
         points.push_back(point);
         pointStates.insert(pair<PointState*, GpuPointState>(&state.points[p], ps));
@@ -172,5 +178,9 @@ bool GpuTrackerPoints::updateGpu(cuda::GpuMat sourceImg, cuda::Stream& stream)
 
     points_ = points.clone();
 
+    // Share of the target's points still followed
+    int active = count_if(state.points.begin(), state.points.end(), [](PointState& p) { return p.active; });
+    confidence = (float)active / max<size_t>(1, state.points.size());
+
     return true;
 }
\ No newline at end of file
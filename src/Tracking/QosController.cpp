@@ -0,0 +1,70 @@
+#include "QosController.h"
+#include "Diagnostics/Metrics.h"
+
+#include <algorithm>
+
+using namespace std;
+
+QosController::QosController(double targetFps)
+    :targetFps(targetFps), budgetMs(1000.0 / max(1.0, targetFps))
+{
+
+}
+
+double QosController::Cost(const QosLevel& l)
+{
+    double side = l.search > 0 ? l.search : fullSearch;
+    return l.scale * l.scale * side * side;
+}
+
+bool QosController::Record(double updateMs)
+{
+    static atomic<int64_t>& changes = METRICS->Counter("qos.changes");
+
+    averageMs = samples == 0 ? updateMs : averageMs + (updateMs - averageMs) * smoothing;
+    samples++;
+
+    if (samples < patience)
+        return false;
+
+    if (averageMs > budgetMs && level < numLevels - 1)
+    {
+        // Every level switch initializes the tracker again, back off from levels that keep failing
+        if (steppedUp)
+            holdoff = min(holdoff * 2, maxHoldoff);
+
+        steppedUp = false;
+        level++;
+        samples = 0;
+        changes++;
+        return true;
+    }
+
+    if (steppedUp && samples >= stableSamples)
+    {
+        steppedUp = false;
+        holdoff = minHoldoff;
+    }
+
+    if (level > 0 && samples >= holdoff)
+    {
+        // Tracking cost grows with the pixels the tracker looks at, at its resolution and within its search region
+        double ratio = Cost(levels[level - 1]) / Cost(levels[level]);
+        if (averageMs * ratio < budgetMs * headroom)
+        {
+            level--;
+            samples = 0;
+            steppedUp = true;
+            changes++;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void QosController::SetLevelIndex(int l)
+{
+    level = min(max(l, 0), numLevels - 1);
+    samples = 0;
+}
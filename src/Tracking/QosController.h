@@ -0,0 +1,64 @@
+#pragma once
+
+struct QosLevel
+{
+    // Working resolution relative to the source frame
+    float scale;
+    // Side of the search region in target sizes, 0 searches the whole frame or range
+    float search;
+};
+
+// Trades tracking resolution for throughput. Watches the update time of one tracker against the
+// frame budget of a target rate, steps down a level when it falls behind and back up with headroom.
+class QosController
+{
+public:
+    QosController(double targetFps);
+
+    // Returns true when the level changed and the tracker has to be initialized again
+    bool Record(double updateMs);
+
+    QosLevel GetLevel() { return levels[level]; };
+    int GetLevelIndex() { return level; };
+    // Starts over at this level, used when restoring a tracker
+    void SetLevelIndex(int l);
+    double GetTargetFps() { return targetFps; };
+    double GetAverageMs() { return averageMs; };
+
+    static constexpr int numLevels = 7;
+    static constexpr QosLevel levels[numLevels] = {
+        { 1.0f, 0 },
+        { 1.0f, 4 },
+        { 0.75f, 4 },
+        { 0.5f, 4 },
+        { 0.5f, 3 },
+        { 0.375f, 3 },
+        { 0.25f, 3 },
+    };
+
+protected:
+    // Relative cost of a level, the pixels the tracker looks at
+    static double Cost(const QosLevel& l);
+
+    double targetFps;
+    double budgetMs;
+    double averageMs = 0;
+    int level = 0;
+    // Updates seen at the current level
+    int samples = 0;
+    // Updates to stay at a level before trying the one above, doubles every time a step up did not hold
+    int holdoff = minHoldoff;
+    bool steppedUp = false;
+
+    // The first updates after init are slow, judge a level only after this many
+    static constexpr int patience = 8;
+    static constexpr double smoothing = 0.2;
+    // Step up only when the predicted time leaves this much of the budget unused
+    static constexpr double headroom = 0.6;
+    static constexpr int minHoldoff = 30;
+    static constexpr int maxHoldoff = 960;
+    // A step up that held this many updates resets the holdoff
+    static constexpr int stableSamples = 120;
+    // Searching the whole frame counted in target sizes, targets rarely cover more than an eighth of the frame side
+    static constexpr float fullSearch = 8;
+};
@@ -0,0 +1,203 @@
+#include "Redetector.h"
+#include "opencl_kernels_tracking.h"
+#include "Diagnostics/Trace.h"
+
+#include <opencv2/imgproc.hpp>
+
+using namespace std;
+using namespace cv;
+
+Redetector::Redetector()
+{
+    if (ocl::useOpenCL())
+    {
+        cv::String err;
+        ocl::ProgramSource nccSrc = ocl::tracking::tldDetector_oclsrc;
+        ocl::Program nccProg(nccSrc, String(), err);
+        nccKernel.create("batchNCC", nccProg);
+    }
+}
+
+Mat Redetector::Normalize(Mat patch)
+{
+    Mat out;
+    resize(patch, out, Size(patchSide, patchSide), 0, 0, INTER_AREA);
+    return out;
+}
+
+void Redetector::AddSample(Mat patch)
+{
+    if (patch.empty())
+        return;
+
+    if (initialTemplate.empty())
+        initialTemplate = patch.clone();
+
+    lastTemplate = patch.clone();
+    samples.push_back(Normalize(patch));
+
+    // Keep the initial sample, drop the oldest of the recent ones
+    if (samples.size() > maxSamples)
+        samples.erase(samples.begin() + 1);
+}
+
+void Redetector::FindCandidates(Mat grey, Rect area, Mat templ, vector<Rect>& out)
+{
+    double scale = min(1.0, (double)searchSide / max(1, min(templ.cols, templ.rows)));
+    Size areaSize(cvRound(area.width * scale), cvRound(area.height * scale));
+    Size templSize(max(1, cvRound(templ.cols * scale)), max(1, cvRound(templ.rows * scale)));
+
+    if (areaSize.width < templSize.width || areaSize.height < templSize.height)
+        return;
+
+    // UMat lets opencv run the correlation through opencl when a device is there
+    UMat areaSmall, templSmall, result;
+    resize(grey(area), areaSmall, areaSize, 0, 0, INTER_AREA);
+    resize(templ, templSmall, templSize, 0, 0, INTER_AREA);
+    matchTemplate(areaSmall, templSmall, result, TM_CCOEFF_NORMED);
+
+    Mat r = result.getMat(ACCESS_READ).clone();
+
+    for (int i = 0; i < maxCandidates; i++)
+    {
+        double best;
+        Point loc;
+        minMaxLoc(r, nullptr, &best, nullptr, &loc);
+
+        // The coarse pass only has to get the right spot into the candidates
+        if (!(best >= minScore * 0.7))
+            break;
+
+        out.emplace_back(
+            area.x + cvRound(loc.x / scale),
+            area.y + cvRound(loc.y / scale),
+            templ.cols,
+            templ.rows
+        );
+
+        // Suppress the neighbourhood so the next candidate is somewhere else
+        Rect around(loc.x - templSize.width / 2, loc.y - templSize.height / 2, templSize.width, templSize.height);
+        r(around & Rect(Point(), r.size())).setTo(-1);
+    }
+}
+
+bool Redetector::ScoreOcl(vector<Mat>& patches, vector<float>& out)
+{
+    if (nccKernel.empty())
+        return false;
+
+    const int area = patchSide * patchSide;
+
+    Mat patchRows((int)patches.size(), area, CV_8U);
+    for (int i = 0; i < patches.size(); i++)
+        patches[i].reshape(1, 1).copyTo(patchRows.row(i));
+
+    Mat sampleRows((int)samples.size(), area, CV_8U);
+    for (int i = 0; i < samples.size(); i++)
+        samples[i].reshape(1, 1).copyTo(sampleRows.row(i));
+
+    // The kernel also scores negative samples, there are none here
+    Mat negativeRows = Mat::zeros(1, area, CV_8U);
+
+    UMat uPatches = patchRows.getUMat(ACCESS_READ);
+    UMat uSamples = sampleRows.getUMat(ACCESS_READ);
+    UMat uNegatives = negativeRows.getUMat(ACCESS_READ);
+    UMat posNcc(1, kernelSamples * (int)patches.size(), CV_32F);
+    UMat negNcc(1, 1, CV_32F);
+
+    nccKernel.args(
+        ocl::KernelArg::PtrReadOnly(uPatches),
+        ocl::KernelArg::PtrReadOnly(uSamples),
+        ocl::KernelArg::PtrReadOnly(uNegatives),
+        ocl::KernelArg::PtrWriteOnly(posNcc),
+        ocl::KernelArg::PtrWriteOnly(negNcc),
+        (int)samples.size(),
+        0,
+        (int)patches.size());
+
+    size_t globSize = kernelSamples * patches.size();
+    if (!nccKernel.run(1, &globSize, nullptr, true))
+        return false;
+
+    Mat scores = posNcc.getMat(ACCESS_READ);
+    for (int i = 0; i < patches.size(); i++)
+    {
+        float best = -1;
+        for (int s = 0; s < samples.size(); s++)
+            best = max(best, scores.at<float>(0, i * kernelSamples + s));
+
+        out[i] = best;
+    }
+
+    return true;
+}
+
+vector<float> Redetector::Score(vector<Mat>& patches)
+{
+    vector<float> out(patches.size(), -1);
+
+    if (!ScoreOcl(patches, out))
+    {
+        for (int i = 0; i < patches.size(); i++)
+        {
+            for (auto& s : samples)
+            {
+                Mat r;
+                matchTemplate(patches[i], s, r, TM_CCOEFF_NORMED);
+                out[i] = max(out[i], r.at<float>(0, 0));
+            }
+        }
+    }
+
+    // Flat patches correlate with anything in the kernel and not at all on the cpu, never trust them
+    for (int i = 0; i < patches.size(); i++)
+    {
+        Scalar mean, dev;
+        meanStdDev(patches[i], mean, dev);
+        if (dev[0] < 1)
+            out[i] = -1;
+    }
+
+    return out;
+}
+
+bool Redetector::Detect(Mat grey, Rect range, Rect& out, double& score)
+{
+    TRACE_SCOPE("redetect search");
+
+    if (samples.empty())
+        return false;
+
+    Rect frame(Point(), grey.size());
+    Rect area = range.empty() ? frame : range & frame;
+
+    vector<Rect> candidates;
+    FindCandidates(grey, area, lastTemplate, candidates);
+    if (samples.size() > 1)
+        FindCandidates(grey, area, initialTemplate, candidates);
+
+    vector<Mat> patches;
+    vector<Rect> boxes;
+    for (auto& c : candidates)
+    {
+        Rect box = c & frame;
+        if (box.width < 2 || box.height < 2)
+            continue;
+
+        boxes.push_back(box);
+        patches.push_back(Normalize(grey(box)));
+    }
+
+    if (patches.empty())
+        return false;
+
+    vector<float> scores = Score(patches);
+    auto best = max_element(scores.begin(), scores.end());
+
+    score = *best;
+    if (score < minScore)
+        return false;
+
+    out = boxes.at(best - scores.begin());
+    return true;
+}
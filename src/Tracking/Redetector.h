@@ -0,0 +1,44 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/core/ocl.hpp>
+#include <deque>
+#include <vector>
+
+// Finds a lost target again. Keeps a small appearance model, a bank of grey patches from the
+// initial selection and from frames that tracked well, and searches the target range with
+// normalised cross-correlation once the tracker gave up.
+class Redetector
+{
+public:
+    Redetector();
+
+    // Grey crop of the target at full resolution, the first one is kept for good
+    void AddSample(cv::Mat patch);
+    bool Empty() { return samples.empty(); };
+
+    // Searches the grey frame inside range (the whole frame when empty), out is the best match of the bank
+    bool Detect(cv::Mat grey, cv::Rect range, cv::Rect& out, double& score);
+
+protected:
+    void FindCandidates(cv::Mat grey, cv::Rect area, cv::Mat templ, std::vector<cv::Rect>& out);
+    // Best correlation of each candidate against the bank
+    std::vector<float> Score(std::vector<cv::Mat>& patches);
+    bool ScoreOcl(std::vector<cv::Mat>& patches, std::vector<float>& out);
+    cv::Mat Normalize(cv::Mat patch);
+
+    cv::Mat initialTemplate;
+    cv::Mat lastTemplate;
+    std::deque<cv::Mat> samples;
+
+    cv::ocl::Kernel nccKernel;
+
+    // Patch size and bank limit of the batchNCC kernel
+    static constexpr int patchSide = 15;
+    static constexpr int kernelSamples = 500;
+    static constexpr int maxSamples = 64;
+    static constexpr int maxCandidates = 8;
+    // The range is searched at a scale that brings the template down to this size
+    static constexpr int searchSide = 24;
+    static constexpr double minScore = 0.65;
+};
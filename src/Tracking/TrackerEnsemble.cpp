@@ -0,0 +1,391 @@
+#include "TrackerEnsemble.h"
+#include "Pipeline/WorkerPool.h"
+#include "Diagnostics/Metrics.h"
+
+#include <algorithm>
+#include <mutex>
+#include <set>
+
+using namespace std;
+using namespace cv;
+
+namespace
+{
+    const char* InternName(const string& name)
+    {
+        static mutex mtx;
+        static set<string> names;
+
+        lock_guard<mutex> lock(mtx);
+        return names.insert(name).first->c_str();
+    }
+}
+
+TrackerEnsemble::TrackerEnsemble(TrackingTarget& target, TrackingStatus& state)
+    :TrackerJT(target, state, TRACKING_TYPE::TYPE_RECT, "TrackerEnsemble", FrameVariant::GPU_RGBA), target(target)
+{
+    // Members refine and restrict themselves, the ensemble only sees their results
+    coarseToFine = false;
+
+    // Two cheap trackers that fail in different ways, and a slow one that holds on through what they lose
+    int cheap = 0;
+    for (auto type : { GPU_POINTS_PYLSPRASE, CPU_RECT_KCF, CPU_RECT_MEDIAN_FLOW })
+    {
+        // The point tracker is not built without cuda
+        TrackerJTStruct s = GetTracker(type);
+        if (cheap == 2 || s.type == TrackerJTType::TRACKER_TYPE_UNKNOWN || !target.SupportsTrackingType(s.trackingType))
+            continue;
+
+        members.emplace_back();
+        members.back().s = s;
+        cheap++;
+    }
+
+    members.emplace_back();
+    members.back().s = GetTracker(CPU_RECT_CSRT);
+    members.back().expensive = true;
+
+    string fullName = "TrackerEnsemble(";
+    for (auto& m : members)
+        fullName += (&m == &members.front() ? "" : "+") + m.s.name;
+    fullName += ")";
+
+    ensembleName = InternName(fullName);
+}
+
+const char* TrackerEnsemble::GetName()
+{
+    return ensembleName;
+}
+
+void TrackerEnsemble::EnableQos(double targetFps)
+{
+    // Every member holds its own rate, the ensemble itself always works on the full frame
+    qosFps = targetFps;
+    for (auto& m : members)
+        if (m.tracker)
+            m.tracker->EnableQos(qosFps);
+}
+
+void TrackerEnsemble::Seed(Member& m, TrackingStatusBase& from, bool keepPoints)
+{
+    m.tracker.reset();
+    m.state.reset(target.InitTracking(m.s.trackingType));
+
+    bool pointsActive = any_of(from.points.begin(), from.points.end(), [](PointState& p) { return p.active; });
+    if (keepPoints && pointsActive && from.points.size() == m.state->points.size())
+    {
+        m.state->points = from.points;
+    }
+    else if (!m.state->points.empty())
+    {
+        // Lost or drifted points start over from the initial layout inside the fused box
+        TrackingTarget moved = target.MovedTo(from.rect);
+        for (int i = 0; i < m.state->points.size() && i < moved.initialPoints.size(); i++)
+        {
+            m.state->points[i].point = moved.initialPoints[i];
+            m.state->points[i].active = true;
+        }
+    }
+
+    m.state->rect = from.rect;
+    m.state->center = from.center;
+    m.state->size = from.size;
+    m.state->active = true;
+
+    if (m.s.trackingType == TRACKING_TYPE::TYPE_POINTS)
+    {
+        // Point trackers report the mean of their points as the centre
+        Point2f sum;
+        int n = 0;
+        for (auto& p : m.state->points)
+        {
+            if (!p.active)
+                continue;
+
+            sum += Point2f(p.point);
+            n++;
+        }
+
+        if (n > 0)
+            m.state->center = Point(sum / n);
+    }
+
+    m.prevCenter = m.state->center;
+    m.tracker.reset(m.s.Create(target, *m.state));
+    if (qosFps > 0)
+        m.tracker->EnableQos(qosFps);
+}
+
+Rect TrackerEnsemble::MemberBox(Member& m, TrackingStatusBase& previous)
+{
+    if (m.s.trackingType == TRACKING_TYPE::TYPE_RECT)
+        return m.state->rect;
+
+    return previous.rect + (m.state->center - m.prevCenter);
+}
+
+bool TrackerEnsemble::Fuse(TrackingStatusBase& previous)
+{
+    struct Vote
+    {
+        Member* m;
+        Rect box;
+        Point2f center;
+        float weight;
+    };
+
+    vector<Vote> votes;
+    int running = 0;
+
+    for (auto& m : members)
+    {
+        m.inlier = false;
+        if (m.paused)
+            continue;
+
+        running++;
+
+        float c = m.state->active ? m.tracker->GetConfidence() : 0;
+        if (c < minConfidence)
+            continue;
+
+        Rect box = MemberBox(m, previous);
+        votes.push_back({ &m, box, (Point2f(box.tl()) + Point2f(box.br())) / 2, c });
+    }
+
+    if (votes.empty())
+    {
+        state.active = false;
+        confidence = 0;
+        return false;
+    }
+
+    float tolerance = max(4.0f, agreeDistance * max(previous.rect.width, previous.rect.height));
+    auto near = [tolerance](Vote& a, Vote& b) {
+        Point2f d = a.center - b.center;
+        return sqrt(d.dot(d)) <= tolerance;
+    };
+
+    // The vote with the most weight around it is the consensus
+    Vote* best = nullptr;
+    float bestSupport = -1;
+    for (auto& a : votes)
+    {
+        float support = 0;
+        for (auto& b : votes)
+            if (near(a, b))
+                support += b.weight;
+
+        if (support > bestSupport)
+        {
+            best = &a;
+            bestSupport = support;
+        }
+    }
+
+    Point2f center;
+    Size2f size;
+    float weight = 0, sizeWeight = 0;
+    bool pointsSet = false;
+    int inliers = 0;
+
+    for (auto& v : votes)
+    {
+        if (!near(*best, v))
+            continue;
+
+        v.m->inlier = true;
+        inliers++;
+
+        center += v.center * v.weight;
+        weight += v.weight;
+
+        if (v.m->s.trackingType == TRACKING_TYPE::TYPE_RECT)
+        {
+            size += Size2f(v.box.size()) * v.weight;
+            sizeWeight += v.weight;
+        }
+        else if (v.m->state->points.size() == state.points.size())
+        {
+            state.points = v.m->state->points;
+            pointsSet = true;
+        }
+    }
+
+    center /= weight;
+    size = sizeWeight > 0 ? size / sizeWeight : Size2f(previous.rect.size());
+
+    if (!pointsSet)
+    {
+        Point2f prevCenter = (Point2f(previous.rect.tl()) + Point2f(previous.rect.br())) / 2;
+        Point moved = center - prevCenter;
+        for (auto& p : state.points)
+            p.point += moved;
+    }
+
+    state.rect = Rect(cvRound(center.x - size.width / 2), cvRound(center.y - size.height / 2), cvRound(size.width), cvRound(size.height));
+    state.active = true;
+    confidence = weight / running;
+    UpdateCenter();
+
+    return inliers == running;
+}
+
+void TrackerEnsemble::UpdateSchedule(bool agreed)
+{
+    static atomic<int64_t>& pauses = METRICS->Counter("ensemble.pauses");
+
+    int cheapRunning = count_if(members.begin(), members.end(), [](Member& m) { return !m.expensive && !m.paused; });
+
+    if (agreed && confidence >= 0.5f && cheapRunning >= 2)
+        agreedFrames++;
+    else
+        agreedFrames = 0;
+
+    if (agreedFrames < agreeFrames)
+        return;
+
+    for (auto& m : members)
+    {
+        if (m.expensive && !m.paused)
+        {
+            m.paused = true;
+            pauses++;
+        }
+    }
+}
+
+template<typename F>
+void TrackerEnsemble::Run(vector<Member*> run, bool parallel, F f)
+{
+    if (!parallel || run.size() < 2)
+    {
+        for (auto m : run)
+            f(*m);
+
+        return;
+    }
+
+    vector<PoolTask> tasks;
+    for (auto m : run)
+        tasks.push_back([m, &f]() { f(*m); });
+
+    WORKER_POOL->RunAll(move(tasks));
+}
+
+template<typename Frame>
+void TrackerEnsemble::InitMembers(Frame& frame, bool parallel)
+{
+    vector<Member*> run;
+    for (auto& m : members)
+    {
+        m.paused = false;
+        Seed(m, state, true);
+        run.push_back(&m);
+    }
+
+    Run(run, parallel, [&frame](Member& m) { m.tracker->init(frame); });
+
+    agreedFrames = 0;
+    state.active = any_of(members.begin(), members.end(), [](Member& m) { return m.state->active; });
+    confidence = state.active ? 1 : 0;
+    UpdateCenter();
+}
+
+template<typename Frame>
+bool TrackerEnsemble::UpdateMembers(Frame& frame, Frame& last, bool parallel)
+{
+    static atomic<int64_t>& wakes = METRICS->Counter("ensemble.wakes");
+    static atomic<int64_t>& reseeds = METRICS->Counter("ensemble.reseeds");
+
+    if (!state.active)
+        return false;
+
+    TrackingStatusBase previous = state;
+
+    vector<Member*> run;
+    for (auto& m : members)
+    {
+        if (m.paused)
+            continue;
+
+        m.prevCenter = m.state->center;
+        run.push_back(&m);
+    }
+
+    Run(run, parallel, [&frame](Member& m) { m.tracker->update(frame); });
+
+    bool agreed = Fuse(previous);
+
+    if (!agreed || confidence < 0.5f)
+    {
+        // The cheap members are not sure, bring the paused ones back from the previous frame
+        vector<Member*> wake;
+        for (auto& m : members)
+        {
+            if (!m.paused)
+                continue;
+
+            m.paused = false;
+            wake.push_back(&m);
+        }
+
+        if (!wake.empty())
+        {
+            wakes++;
+            Run(wake, parallel, [this, &previous, &frame, &last](Member& m) {
+                Seed(m, previous, true);
+                m.tracker->init(last);
+                m.tracker->update(frame);
+            });
+
+            agreed = Fuse(previous);
+        }
+    }
+
+    // Members that lost the target or drifted off start over on the consensus
+    if (state.active)
+    {
+        vector<Member*> reseed;
+        for (auto& m : members)
+            if (!m.paused && !m.inlier)
+                reseed.push_back(&m);
+
+        reseeds += reseed.size();
+        Run(reseed, parallel, [this, &frame](Member& m) {
+            Seed(m, state, false);
+            m.tracker->init(frame);
+        });
+    }
+
+    UpdateSchedule(agreed);
+    return state.active;
+}
+
+void TrackerEnsemble::init(cuda::GpuMat frame)
+{
+    InitMembers(frame, true);
+    lastFrame = frame;
+}
+
+bool TrackerEnsemble::update(cuda::GpuMat frame, cuda::Stream& stream)
+{
+    bool ok = UpdateMembers(frame, lastFrame, true);
+    lastFrame = frame;
+    return ok;
+}
+
+void TrackerEnsemble::init(HostFrame& frame)
+{
+    // Members add their variants to the host frame, they take turns
+    InitMembers(frame, false);
+    lastHostFrame = frame;
+}
+
+bool TrackerEnsemble::update(HostFrame& frame)
+{
+    bool ok = UpdateMembers(frame, lastHostFrame, false);
+    lastHostFrame = frame;
+    return ok;
+}
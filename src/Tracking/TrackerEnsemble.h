@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Trackers.h"
+
+#include <memory>
+#include <vector>
+
+// Runs a few complementary trackers on the same target and fuses their results by confidence.
+// Members that disagree with the consensus start over from the fused result, the most expensive
+// member sits out while the cheap ones agree and is brought back as soon as they do not.
+class TrackerEnsemble : public TrackerJT
+{
+public:
+    TrackerEnsemble(TrackingTarget& target, TrackingStatus& state);
+
+    void init(cv::cuda::GpuMat frame) override;
+    bool update(cv::cuda::GpuMat frame, cv::cuda::Stream& stream = cv::cuda::Stream::Null()) override;
+    void init(HostFrame& frame) override;
+    bool update(HostFrame& frame) override;
+
+    void EnableQos(double targetFps) override;
+    const char* GetName() override;
+
+protected:
+    struct Member
+    {
+        TrackerJTStruct s;
+        std::unique_ptr<TrackingStatus> state;
+        std::unique_ptr<TrackerJT> tracker;
+        // Point trackers only move, their box is the fused one shifted by the motion of the centre
+        cv::Point prevCenter;
+        bool expensive = false;
+        bool paused = false;
+        bool inlier = true;
+    };
+
+    // Fresh tracker for the member, starting from the given result
+    void Seed(Member& m, TrackingStatusBase& from, bool keepPoints);
+    cv::Rect MemberBox(Member& m, TrackingStatusBase& previous);
+    // Fuses the active members into the state, returns true when all of them agree
+    bool Fuse(TrackingStatusBase& previous);
+    void UpdateSchedule(bool agreed);
+
+    template<typename Frame>
+    void InitMembers(Frame& frame, bool parallel);
+    template<typename Frame>
+    bool UpdateMembers(Frame& frame, Frame& last, bool parallel);
+    template<typename F>
+    void Run(std::vector<Member*> run, bool parallel, F f);
+
+    TrackingTarget& target;
+    std::vector<Member> members;
+    double qosFps = 0;
+    int agreedFrames = 0;
+
+    cv::cuda::GpuMat lastFrame;
+    HostFrame lastHostFrame;
+
+    // Interned, the tracer keeps name pointers after the tracker is gone
+    const char* ensembleName;
+
+    // Members below this confidence do not vote
+    static constexpr float minConfidence = 0.2f;
+    // Centres closer than this share of the target size agree
+    static constexpr float agreeDistance = 0.25f;
+    // Frames the cheap members have to agree before the expensive one is paused
+    static const int agreeFrames = 30;
+};
@@ -52,6 +52,11 @@ bool TrackerOpenCV::updateCpu(Mat m)
 
 
         state.rect = out;
+
+        // Only the siamese tracker reports a score
+        Ptr<TrackerDaSiamRPN> siam = tracker.dynamicCast<TrackerDaSiamRPN>();
+        if (siam)
+            confidence = siam->getTrackingScore();
     }
     catch (exception e)
     {
@@ -1,27 +1,50 @@
 #include "Trackers.h"
 #include "FrameCache.h"
+#ifdef WITH_CUDA
 #include "GpuTrackerPoints.h"
+#endif
 #include "TrackerOpenCV.h"
+#include "TrackerEnsemble.h"
 
 #include <opencv2/tracking.hpp>
 #include <opencv2/tracking/tracking_legacy.hpp>
 #include <opencv2/dnn.hpp>
+#include <opencv2/imgproc.hpp>
+#include <chrono>
 
 using namespace std;
 using namespace cv;
 
+ResourcePool<Tracker>* TRACKER_POOL = new ResourcePool<Tracker>("pool.trackers");
+
+// Missing entries keep the default of the tracker
+template<typename T>
+static void ReadParam(json& j, const char* name, T& value)
+{
+    if (j.contains(name))
+        value = j[name].get<T>();
+}
+
 TrackerJTStruct GetTracker(TrackerJTType type)
 {
     switch (type) {
+#ifdef WITH_CUDA
     case GPU_POINTS_PYLSPRASE:
         return {
             type,
             TRACKING_TYPE::TYPE_POINTS,
             "GpuTrackerPoints",
-            [](auto& t, auto& s) {
-                return new GpuTrackerPoints(t, s);
+            [type](auto& t, auto& s) {
+                json j = t.GetTrackerParams(type);
+                GpuTrackerPoints::Params p;
+                ReadParam(j, "size", p.size);
+                ReadParam(j, "max_level", p.maxLevel);
+                ReadParam(j, "iters", p.iters);
+
+                return new GpuTrackerPoints(t, s, p);
             }
         };
+#endif
         /*
     case GPU_RECT_GOTURN:
         return {
@@ -39,12 +62,22 @@ TrackerJTStruct GetTracker(TrackerJTType type)
             type,
             TRACKING_TYPE::TYPE_RECT,
             "TrackerDaSiamRPN",
-            [](auto& t, auto& s) {
+            [type](auto& t, auto& s) {
+                json j = t.GetTrackerParams(type);
                 TrackerDaSiamRPN::Params p;
+#ifdef WITH_CUDA
                 p.backend = dnn::DNN_BACKEND_CUDA;
                 p.target = dnn::DNN_TARGET_CUDA;
+#endif
+                ReadParam(j, "backend", p.backend);
+                ReadParam(j, "target", p.target);
+
+                // Loading the three networks costs more than tracking a few seconds, init starts a pooled one over
+                Ptr<Tracker> tracker = TRACKER_POOL->Take("TrackerDaSiamRPN" + j.dump(), [&p]() -> shared_ptr<Tracker> {
+                    return TrackerDaSiamRPN::create(p);
+                });
 
-                return new TrackerOpenCV(t, s, TrackerDaSiamRPN::create(p), "TrackerDaSiamRPN");
+                return new TrackerOpenCV(t, s, tracker, "TrackerDaSiamRPN");
             }
         };
     case CPU_RECT_MEDIAN_FLOW:
@@ -61,8 +94,20 @@ TrackerJTStruct GetTracker(TrackerJTType type)
             type,
             TRACKING_TYPE::TYPE_RECT,
             "TrackerCSRT",
-            [](auto& t, auto& s) {
-                return new TrackerOpenCV(t, s, TrackerCSRT::create(), "TrackerCSRT");
+            [type](auto& t, auto& s) {
+                json j = t.GetTrackerParams(type);
+                TrackerCSRT::Params p;
+                ReadParam(j, "use_hog", p.use_hog);
+                ReadParam(j, "use_color_names", p.use_color_names);
+                ReadParam(j, "use_segmentation", p.use_segmentation);
+                ReadParam(j, "template_size", p.template_size);
+                ReadParam(j, "padding", p.padding);
+                ReadParam(j, "filter_lr", p.filter_lr);
+                ReadParam(j, "admm_iterations", p.admm_iterations);
+                ReadParam(j, "number_of_scales", p.number_of_scales);
+                ReadParam(j, "scale_step", p.scale_step);
+
+                return new TrackerOpenCV(t, s, TrackerCSRT::create(p), "TrackerCSRT");
             }
         };
         
@@ -81,8 +126,31 @@ TrackerJTStruct GetTracker(TrackerJTType type)
             type,
             TRACKING_TYPE::TYPE_RECT,
             "TrackerKCF",
+            [type](auto& t, auto& s) {
+                json j = t.GetTrackerParams(type);
+                TrackerKCF::Params p;
+                ReadParam(j, "detect_thresh", p.detect_thresh);
+                ReadParam(j, "sigma", p.sigma);
+                ReadParam(j, "lambda", p.lambda);
+                ReadParam(j, "interp_factor", p.interp_factor);
+                ReadParam(j, "output_sigma_factor", p.output_sigma_factor);
+                ReadParam(j, "resize", p.resize);
+                ReadParam(j, "max_patch_size", p.max_patch_size);
+                ReadParam(j, "compress_feature", p.compress_feature);
+                ReadParam(j, "compressed_size", p.compressed_size);
+                ReadParam(j, "pca_learning_rate", p.pca_learning_rate);
+
+                return new TrackerOpenCV(t, s, TrackerKCF::create(p), "TrackerKCF");
+            }
+        };
+
+    case ENSEMBLE_FUSED:
+        return {
+            type,
+            TRACKING_TYPE::TYPE_RECT,
+            "TrackerEnsemble",
             [](auto& t, auto& s) {
-                return new TrackerOpenCV(t, s, TrackerKCF::create(), "TrackerKCF");
+                return new TrackerEnsemble(t, s);
             }
         };
 
@@ -103,27 +171,46 @@ TrackerJT::TrackerJT(TrackingTarget& target, TrackingStatus& state, TRACKING_TYP
     :state(state), type(type), name(name), frameType(frameType)
 {
     assert(target.SupportsTrackingType(type));
+    coarseToFine = target.coarseToFine && type == TRACKING_TYPE::TYPE_RECT;
+
     if (!target.range.empty())
+    {
+        range = target.range;
         window = target.range;
+    }
 }
 
 void TrackerJT::init(cuda::GpuMat frame)
 {
+    if (qos || coarseToFine)
+        ApplyLevel(frame.size());
+
     try {
+        ToWorking();
+
         if (FRAME_CACHE->IsCpu(frameType))
         {
-            Mat cpuFrame = FRAME_CACHE->CpuVariant(frame, frameType);
+            Mat cpuFrame = FRAME_CACHE->CpuVariant(frame, frameType, cuda::Stream::Null(), scale);
             initCpu(cpuFrame);
         }
         else
         {
-            cuda::GpuMat gpuFrame = FRAME_CACHE->GpuVariant(frame, frameType);
+            cuda::GpuMat gpuFrame = FRAME_CACHE->GpuVariant(frame, frameType, cuda::Stream::Null(), scale);
             initGpu(gpuFrame);
         }
+
+        FromWorking();
+
+        Rect r = state.rect & Rect(Point(), frame.size());
+        if (coarseToFine && !r.empty())
+            FRAME_CACHE->GpuVariant(frame, GPU_GREY)(r).download(fineTemplate);
     }
     catch (exception e) {
+        FromWorking();
         state.active = false;
     }
+
+    confidence = state.active ? 1 : 0;
 }
 
 bool TrackerJT::update(cuda::GpuMat frame, cuda::Stream& stream)
@@ -131,23 +218,324 @@ bool TrackerJT::update(cuda::GpuMat frame, cuda::Stream& stream)
     if (!state.active)
         return false;
 
+    auto start = chrono::steady_clock::now();
+    ToWorking();
+
+    bool found;
+    confidence = 1;
+
     if (FRAME_CACHE->IsCpu(frameType))
     {
-        Mat cpuFrame = FRAME_CACHE->CpuVariant(frame, frameType);
-        updateCpu(cpuFrame);
+        Mat cpuFrame = FRAME_CACHE->CpuVariant(frame, frameType, cuda::Stream::Null(), scale);
+        found = updateCpu(cpuFrame);
     }
     else
     {
-        cuda::GpuMat gpuFrame = FRAME_CACHE->GpuVariant(frame, frameType);
-        updateGpu(gpuFrame);
+        cuda::GpuMat gpuFrame = FRAME_CACHE->GpuVariant(frame, frameType, cuda::Stream::Null(), scale);
+        found = updateGpu(gpuFrame);
+    }
+
+    FromWorking();
+
+    if (!found)
+        confidence = 0;
+
+    if (!fineTemplate.empty() && state.active)
+    {
+        // Only the search window leaves the gpu
+        Rect s = FineSearchRect(frame.size());
+        Mat search;
+        if (!s.empty())
+        {
+            FRAME_CACHE->GpuVariant(frame, GPU_GREY)(s).download(search);
+            RefineFine(search, s.tl());
+        }
+    }
+
+    UpdateCenter();
+
+    if (!state.active)
+        confidence = 0;
+
+    if (qos && state.active && UpdateQos(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count()))
+    {
+        // The result of this frame does not get more certain by starting on a new level
+        float c = confidence;
+        init(frame);
+        confidence = min(confidence, c);
     }
 
+    return state.active;
+}
+
+void TrackerJT::UpdateCenter()
+{
     if (state.active && type == TRACKING_TYPE::TYPE_RECT) {
         state.center.x = state.rect.x + (state.rect.width / 2);
         state.center.y = state.rect.y + (state.rect.height / 2);
 
         state.size = state.rect.width + state.rect.height / 2;
     }
+}
+
+void TrackerJT::EnableQos(double targetFps)
+{
+    qos = make_unique<QosController>(targetFps);
+}
+
+void TrackerJT::SaveModel(json& j)
+{
+    if (qos)
+        j["qos_level"] = qos->GetLevelIndex();
+}
+
+void TrackerJT::LoadModel(json& j)
+{
+    // Starting again at full resolution would cost the first few frames until the level is found again
+    if (qos && j.contains("qos_level"))
+        qos->SetLevelIndex(j["qos_level"]);
+}
+
+static Rect ScaleRect(Rect r, float scale)
+{
+    return Rect(cvRound(r.x * scale), cvRound(r.y * scale), cvRound(r.width * scale), cvRound(r.height * scale));
+}
+
+void TrackerJT::ToWorking()
+{
+    if (scale == 1)
+        return;
+
+    state.rect = ScaleRect(state.rect, scale);
+    state.center = Point(cvRound(state.center.x * scale), cvRound(state.center.y * scale));
+    for (auto& p : state.points)
+        p.point = Point(cvRound(p.point.x * scale), cvRound(p.point.y * scale));
+}
+
+void TrackerJT::FromWorking()
+{
+    if (scale == 1)
+        return;
+
+    float inverse = 1 / scale;
+    state.rect = ScaleRect(state.rect, inverse);
+    state.center = Point(cvRound(state.center.x * inverse), cvRound(state.center.y * inverse));
+    for (auto& p : state.points)
+        p.point = Point(cvRound(p.point.x * inverse), cvRound(p.point.y * inverse));
+}
+
+Rect TrackerJT::TargetBox()
+{
+    if (type == TRACKING_TYPE::TYPE_RECT)
+        return state.rect;
+
+    vector<Point> active;
+    for (auto& p : state.points)
+        if (p.active)
+            active.push_back(p.point);
+
+    return active.empty() ? state.rect : boundingRect(active);
+}
+
+void TrackerJT::ApplyLevel(Size frameSize)
+{
+    QosLevel level = qos ? qos->GetLevel() : QosLevel{ 1, 0 };
+    Rect frameRect(Point(), frameSize);
+
+    if (coarseToFine)
+    {
+        Rect box = TargetBox();
+        coarseScale = min(1.0f, max(0.25f, (float)coarseTargetSize / max(1, max(box.width, box.height))));
+    }
+
+    scale = level.scale * coarseScale;
+    bounds = range.empty() ? frameRect : range & frameRect;
+    region = bounds;
+
+    if (level.search > 0)
+    {
+        Rect box = TargetBox();
+        int side = cvRound(max(box.width, box.height) * level.search);
+        Point center = (box.tl() + box.br()) / 2;
+
+        region = Rect(center.x - side / 2, center.y - side / 2, side, side) & bounds;
+    }
+
+    if (region == frameRect)
+        window = Rect();
+    else
+        window = ScaleRect(region, scale) & Rect(Point(), FrameCache::ScaledSize(frameSize, scale));
+}
+
+bool TrackerJT::UpdateQos(double updateMs)
+{
+    if (qos->Record(updateMs))
+        return true;
+
+    if (qos->GetLevel().search == 0)
+        return false;
+
+    // Recentre once the target gets close to a side of the region that is not the frame border
+    Rect box = TargetBox();
+    int mx = region.width / 4, my = region.height / 4;
+
+    return (box.x < region.x + mx && region.x > bounds.x)
+        || (box.y < region.y + my && region.y > bounds.y)
+        || (box.br().x > region.br().x - mx && region.br().x < bounds.br().x)
+        || (box.br().y > region.br().y - my && region.br().y < bounds.br().y);
+}
+
+Rect TrackerJT::FineSearchRect(Size frameSize)
+{
+    // The coarse result is off by up to a working pixel
+    int radius = cvCeil(2 / scale) + 2;
+    Point center = (state.rect.tl() + state.rect.br()) / 2;
+
+    Rect s(
+        center.x - fineTemplate.cols / 2 - radius,
+        center.y - fineTemplate.rows / 2 - radius,
+        fineTemplate.cols + radius * 2,
+        fineTemplate.rows + radius * 2
+    );
+
+    return s & Rect(Point(), frameSize);
+}
+
+void TrackerJT::RefineFine(Mat search, Point offset)
+{
+    if (search.cols < fineTemplate.cols || search.rows < fineTemplate.rows)
+        return;
+
+    Mat score;
+    matchTemplate(search, fineTemplate, score, TM_CCOEFF_NORMED);
+
+    double best;
+    Point loc;
+    minMaxLoc(score, nullptr, &best, nullptr, &loc);
+
+    // Flat templates score nan, keep the coarse result then
+    if (!(best >= minFineScore))
+    {
+        if (best == best)
+            confidence = min(confidence, (float)max(0.0, best));
+
+        return;
+    }
+
+    confidence = min(confidence, (float)best);
+
+    Point center = offset + loc + Point(fineTemplate.cols / 2, fineTemplate.rows / 2);
+    state.rect.x = center.x - state.rect.width / 2;
+    state.rect.y = center.y - state.rect.height / 2;
+}
+
+Mat TrackerJT::HostVariant(HostFrame& frame, FrameVariant v)
+{
+    // Gpu and local variants hold the same pixels, only the memory differs
+    FrameVariant local = FrameCache::LocalVariant(v);
+
+    auto found = frame.find(local);
+    if (found != frame.end())
+        return found->second;
+
+    Mat& rgba = frame.at(GPU_RGBA);
+    Mat& out = frame[local];
+
+    switch (local) {
+    case GPU_RGBA:
+        break;
+    case LOCAL_RGB:
+        cvtColor(rgba, out, COLOR_BGRA2BGR);
+        break;
+    case LOCAL_GREY:
+        cvtColor(rgba, out, COLOR_BGRA2GRAY);
+        break;
+    default:
+        throw "Failed";
+    }
+
+    return frame.at(local);
+}
+
+Mat TrackerJT::ScaleHost(Mat frame)
+{
+    if (scale == 1)
+        return frame;
+
+    Mat scaled;
+    resize(frame, scaled, FrameCache::ScaledSize(frame.size(), scale), 0, 0, INTER_AREA);
+    return scaled;
+}
+
+void TrackerJT::init(HostFrame& frame)
+{
+    if (qos || coarseToFine)
+        ApplyLevel(frame.at(GPU_RGBA).size());
+
+    try {
+        Mat hostFrame = ScaleHost(HostVariant(frame, frameType));
+        ToWorking();
+
+        if (FRAME_CACHE->IsCpu(frameType))
+            initCpu(hostFrame);
+        else
+            initGpu(cuda::GpuMat(hostFrame));
+
+        FromWorking();
+
+        Rect r = state.rect & Rect(Point(), frame.at(GPU_RGBA).size());
+        if (coarseToFine && !r.empty())
+            HostVariant(frame, LOCAL_GREY)(r).copyTo(fineTemplate);
+    }
+    catch (exception e) {
+        FromWorking();
+        state.active = false;
+    }
+
+    confidence = state.active ? 1 : 0;
+}
+
+bool TrackerJT::update(HostFrame& frame)
+{
+    if (!state.active)
+        return false;
+
+    auto start = chrono::steady_clock::now();
+    Mat hostFrame = ScaleHost(HostVariant(frame, frameType));
+    ToWorking();
+
+    bool found;
+    confidence = 1;
+
+    if (FRAME_CACHE->IsCpu(frameType))
+        found = updateCpu(hostFrame);
+    else
+        found = updateGpu(cuda::GpuMat(hostFrame));
+
+    FromWorking();
+
+    if (!found)
+        confidence = 0;
+
+    if (!fineTemplate.empty() && state.active)
+    {
+        Rect s = FineSearchRect(frame.at(GPU_RGBA).size());
+        if (!s.empty())
+            RefineFine(HostVariant(frame, LOCAL_GREY)(s), s.tl());
+    }
+
+    UpdateCenter();
+
+    if (!state.active)
+        confidence = 0;
+
+    if (qos && state.active && UpdateQos(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count()))
+    {
+        // The result of this frame does not get more certain by starting on a new level
+        float c = confidence;
+        init(frame);
+        confidence = min(confidence, c);
+    }
 
     return state.active;
-}
\ No newline at end of file
+}
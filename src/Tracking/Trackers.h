@@ -3,10 +3,18 @@
 #include "Model/Model.h"
 #include "Model/TrackingTarget.h"
 #include "Model/TrackingStatus.h"
+#include "QosController.h"
+#include "Pipeline/ResourcePool.h"
 
 #include <string>
 #include <functional>
+#include <map>
+#include <memory>
 #include <opencv2/core/cuda.hpp>
+#include <opencv2/video/tracking.hpp>
+
+// Frame held in host memory, GPU_RGBA is the decoded frame and other variants are filled in on demand
+typedef std::map<FrameVariant, cv::Mat> HostFrame;
 
 class TrackerJT;
 
@@ -26,13 +34,37 @@ class TrackerJT
 public:
     TrackerJT(TrackingTarget& target, TrackingStatus& state, TRACKING_TYPE type, const char* name, FrameVariant frameType);
 
-    void init(cv::cuda::GpuMat frame);
-    bool update(cv::cuda::GpuMat frame, cv::cuda::Stream& stream = cv::cuda::Stream::Null());
+    virtual ~TrackerJT() {};
+
+    virtual void init(cv::cuda::GpuMat frame);
+    virtual bool update(cv::cuda::GpuMat frame, cv::cuda::Stream& stream = cv::cuda::Stream::Null());
+
+    // Feed frames without the decoder and frame cache, used for replaying recordings
+    virtual void init(HostFrame& frame);
+    virtual bool update(HostFrame& frame);
+    static cv::Mat HostVariant(HostFrame& frame, FrameVariant v);
     virtual const char* GetName()
     {
         return name;
     };
 
+    FrameVariant GetFrameType()
+    {
+        return frameType;
+    };
+
+    // Lowers the working resolution and search region while updates take longer than a frame at this rate
+    virtual void EnableQos(double targetFps);
+    QosController* GetQos() { return qos.get(); };
+    float GetScale() { return scale; };
+    // How far the last result can be trusted, 0 lost and 1 certain
+    float GetConfidence() { return confidence; };
+
+    // Internal state for checkpoints, loaded before init. The base keeps the qos level,
+    // backends whose model survives a restart add their own
+    virtual void SaveModel(json& j);
+    virtual void LoadModel(json& j);
+
 protected:
     virtual void initCpu(cv::Mat frame) { throw "Not implemented"; };
     virtual bool updateCpu(cv::Mat frame) { throw "Not implemented"; };
@@ -40,10 +72,46 @@ protected:
     virtual void initGpu(cv::cuda::GpuMat frame) { throw "Not implemented"; };
     virtual bool updateGpu(cv::cuda::GpuMat, cv::cuda::Stream& stream = cv::cuda::Stream::Null()) { throw "Not implemented"; };
 
+    void UpdateCenter();
+
+    // Trackers work in the scaled frame, the state is kept in source coordinates
+    void ToWorking();
+    void FromWorking();
+    cv::Rect TargetBox();
+    // Picks scale, region and window for the current level around the current state
+    void ApplyLevel(cv::Size frameSize);
+    // True when the tracker has to be initialized again for a new level or a recentred region
+    bool UpdateQos(double updateMs);
+    cv::Mat ScaleHost(cv::Mat frame);
+
+    // Coarse to fine, the full resolution template is matched in a small window around the coarse result
+    cv::Rect FineSearchRect(cv::Size frameSize);
+    void RefineFine(cv::Mat search, cv::Point offset);
+
     TRACKING_TYPE type;
     TrackingStatus& state;
     const char* name;
     FrameVariant frameType = FrameVariant::VARIANT_UNKNOWN;
     cv::Rect window;
     bool isCpu = true;
-};
\ No newline at end of file
+    // Backends lower it during their update where they have a score
+    float confidence = 1;
+
+    // Target range in source coordinates, window is the part of the working frame the tracker sees
+    cv::Rect range;
+    float scale = 1;
+    cv::Rect region;
+    cv::Rect bounds;
+    std::unique_ptr<QosController> qos;
+
+    bool coarseToFine = false;
+    float coarseScale = 1;
+    cv::Mat fineTemplate;
+
+    // Coarse scale brings the larger side of the target down to about this many pixels
+    static constexpr int coarseTargetSize = 64;
+    static constexpr double minFineScore = 0.5;
+};
+
+// Trackers that load network weights, kept loaded between runs once a capacity is set, see JobServer
+extern ResourcePool<cv::Tracker>* TRACKER_POOL;